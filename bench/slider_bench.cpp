@@ -0,0 +1,106 @@
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <vector>
+#include "../include/game_data.h"
+
+// compares the magic and PEXT slider backends on this machine
+// run it on each host and set CHESS_SLIDER_BACKEND to the faster one if the default pick is wrong
+
+struct bench_result {
+	double lookup_ns; // average time for one rook + bishop lookup
+	double movegen_ms; // time to generate every piece's valid moves over the test positions
+};
+
+bench_result run_bench(const slider_backend backend, const std::vector<sb> &occupancies) {
+	table_bundle tables;
+	tables.lookup_table.slider_table.init(tables.lookup_table.bishop_table, tables.lookup_table.rook_table, backend);
+	const slider_tables &sliders{tables.lookup_table.slider_table};
+
+	bench_result result{};
+
+	// raw lookups, summing the results so the loop can't be optimized out
+	sb sink{0};
+	auto start = std::chrono::steady_clock::now();
+	for (int round{0}; round < 16; round++) {
+		for (size_t i{0}; i < occupancies.size(); i++) {
+			const int pos{static_cast<int>(i & 63)};
+			sink += sliders.rook_attacks(pos, occupancies[i]) ^ sliders.bishop_attacks(pos, occupancies[i]);
+		}
+	}
+	auto end = std::chrono::steady_clock::now();
+	result.lookup_ns = std::chrono::duration<double, std::nano>(end - start).count() / (16.0 * occupancies.size());
+
+	// move generation over some middlegame positions
+	const std::vector<std::string> fens{
+		"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR",
+		"r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP2BPPP/R2QKB1R",
+		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R",
+		"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8",
+		"r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R"
+	};
+
+	start = std::chrono::steady_clock::now();
+	for (int round{0}; round < 200; round++) {
+		for (const auto &fen: fens) {
+			game_data gd(fen, tables.lookup_table);
+			for (int pos{0}; pos < 64; pos++) {
+				if (gd.piece_lookup[pos] == 255) { continue; }
+				sink += gd.get_valid_moves(pos, tables.lookup_table, tables.between_table);
+			}
+		}
+	}
+	end = std::chrono::steady_clock::now();
+	result.movegen_ms = std::chrono::duration<double, std::milli>(end - start).count();
+
+	if (sink == 0x1234) { std::cout << ""; }
+
+	return result;
+}
+
+int main() {
+	const table_bundle &tables{table_bundle::shared()};
+	const lookup_tables &lt{tables.lookup_table};
+
+	// random occupancies with roughly a middlegame density
+	std::mt19937_64 rng(2024);
+	std::vector<sb> occupancies(1 << 20);
+	for (auto &occupancy: occupancies) { occupancy = rng() & rng(); }
+
+	std::cout << "detected backend: "
+			<< (slider_tables::detect_backend() == slider_backend::PEXT ? "pext" : "magic") << std::endl;
+
+	// make sure both backends agree with the arm walk before timing them
+	slider_tables magic;
+	magic.init(lt.bishop_table, lt.rook_table, slider_backend::MAGIC);
+	slider_tables pext;
+	pext.init(lt.bishop_table, lt.rook_table, slider_backend::PEXT);
+
+	const bool has_pext{pext.get_backend() == slider_backend::PEXT};
+	if (!has_pext) { std::cout << "PEXT not available on this CPU, only timing magics" << std::endl; }
+
+	for (size_t i{0}; i < 100000; i++) {
+		const int pos{static_cast<int>(i & 63)};
+		const sb rook{slider_tables::arm_attacks(lt.rook_table[pos], pos, occupancies[i])};
+		const sb bishop{slider_tables::arm_attacks(lt.bishop_table[pos], pos, occupancies[i])};
+
+		if (magic.rook_attacks(pos, occupancies[i]) != rook || magic.bishop_attacks(pos, occupancies[i]) != bishop
+		    || pext.rook_attacks(pos, occupancies[i]) != rook || pext.bishop_attacks(pos, occupancies[i]) != bishop) {
+			std::cout << "MISMATCH at square " << pos << std::endl;
+			return 1;
+		}
+	}
+
+	const bench_result magic_result{run_bench(slider_backend::MAGIC, occupancies)};
+	std::cout << "magic: " << magic_result.lookup_ns << " ns/lookup, " << magic_result.movegen_ms << " ms movegen"
+			<< std::endl;
+
+	if (has_pext) {
+		const bench_result pext_result{run_bench(slider_backend::PEXT, occupancies)};
+		std::cout << "pext:  " << pext_result.lookup_ns << " ns/lookup, " << pext_result.movegen_ms << " ms movegen"
+				<< std::endl;
+		std::cout << "faster: " << (pext_result.lookup_ns < magic_result.lookup_ns ? "pext" : "magic") << std::endl;
+	}
+
+	return 0;
+}
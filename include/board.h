@@ -0,0 +1,74 @@
+#pragma once
+
+#include "types.h"
+
+#include <string>
+
+// compact alternative to game_data: piece type and color bitboards, a mailbox and packed state in two cache lines
+// there are no per piece arrays or cached attacks, everything is worked out from the bitboards when it is needed
+// a standalone core for now: chess and the search still run on game_data, nothing outside the tests builds a board
+// (it has no make/unmake, move generation into move lists or hash yet)
+class alignas(64) board {
+	// first cache line
+	std::array<sb, 6> pieces{}; // indexed by piece_type
+	std::array<sb, 2> colors{}; // indexed by piece_color
+
+	// second cache line
+	std::array<uint8_t, 32> mailbox{}; // two squares per byte, 0 is empty else 1 + type + 6 * color
+	uint16_t state{0}; // see the state bits below
+
+	// state bits
+	static constexpr uint16_t WHITE_KINGSIDE{1 << 0};
+	static constexpr uint16_t WHITE_QUEENSIDE{1 << 1};
+	static constexpr uint16_t BLACK_KINGSIDE{1 << 2};
+	static constexpr uint16_t BLACK_QUEENSIDE{1 << 3};
+	static constexpr int EN_PASSANT_SHIFT{4}; // bits 4-9, the square of the pawn that just double moved
+	static constexpr uint16_t EN_PASSANT_VALID{1 << 10};
+	static constexpr uint16_t WHITE_TO_MOVE{1 << 11};
+
+	void put_piece(int pos, piece_type type, piece_color color);
+	void remove_piece(int pos);
+
+	// the attacks of one side, sliders see through the enemy king like game_data::side_attacks
+	[[nodiscard]] sb side_attacks(piece_color color) const;
+	// the squares a pinned piece may still move to (every square if it isn't pinned)
+	[[nodiscard]] sb pin_mask(int pos, piece_color color, const lookup_tables &lookup_table,
+	                          const between_tables &between_table) const;
+
+public:
+	board() = default;
+
+	explicit board(const std::string &fen) { set(fen); }
+
+	[[nodiscard]] std::string get() const;
+	// reads placement, side to move, castling and en passant; missing castling rights are given to any king and
+	// rook still on their starting squares
+	void set(const std::string &fen);
+
+	[[nodiscard]] piece_type get_type(const int pos) const {
+		const int code{mailbox[pos >> 1] >> ((pos & 1) * 4) & 0xF};
+		return code == 0 ? piece_type::EMPTY : static_cast<piece_type>((code - 1) % 6);
+	}
+
+	[[nodiscard]] piece_color get_color(const int pos) const {
+		const int code{mailbox[pos >> 1] >> ((pos & 1) * 4) & 0xF};
+		return code == 0 ? piece_color::NONE : static_cast<piece_color>((code - 1) / 6);
+	}
+
+	[[nodiscard]] sb get_pieces(const piece_type type, const piece_color color) const {
+		return pieces[static_cast<int>(type)] & colors[static_cast<int>(color)];
+	}
+
+	[[nodiscard]] piece_color side_to_move() const {
+		return state & WHITE_TO_MOVE ? piece_color::WHITE : piece_color::BLACK;
+	}
+
+	[[nodiscard]] float evaluate_position() const;
+
+	// same rules as game_data::get_valid_moves (pins and king safety, but not check evasion)
+	[[nodiscard]] sb get_valid_moves(int pos, const lookup_tables &lookup_table,
+	                                 const between_tables &between_table) const;
+	void move(int old_idx, int new_idx, const lookup_tables &lookup_table);
+};
+
+static_assert(sizeof(board) == 128, "board should fit in two cache lines");
@@ -1,46 +1,332 @@
 #pragma once
 
 #include "game_data.h"
+#include "movegen.h"
+#include "search_stats.h"
+#include "transposition.h"
 #include "types.h"
+#include "work_stealing_pool.h"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <future>
+#include <mutex>
+#include <stop_token>
 #include <string>
+#include <thread>
+#include <vector>
+
+// limits for one ai_move, 0 means no limit (the depth is always capped at chess::MAX_DEPTH)
+struct search_limits {
+	int depth{0};
+	int soft_time_ms{0}; // no new iteration is started after this
+	int hard_time_ms{0}; // the search is cut off mid iteration after this
+	uint64_t nodes{0};
+};
+
+// how ai_move uses more than one thread (see chess::set_threads)
+enum class parallel_mode : uint8_t {
+	LAZY_SMP, // every thread searches the whole tree, sharing the transposition table
+	YBWC // nodes are split between threads once their first move is searched (young brothers wait)
+};
+
+// one root move, its score and the line the search expects to follow from it
+struct pv_line {
+	int score;
+	std::vector<chess_move> moves; // the root move first
+};
+
+// nodes searched by one thread in one search
+struct thread_stats {
+	uint64_t nodes;
+	double nodes_per_second;
+	uint64_t split_nodes; // the part of nodes searched as a ybwc brother, whoever split the node
+};
+
+// what a search found
+struct search_result {
+	chess_move best_move{}; // the null move if there is no legal move
+	int score{0}; // for the side to move at the root, of lines[0]
+	int depth{0}; // the last iteration that finished
+	// best first, one per multi-pv line (see chess::set_multi_pv); a search cut off after some of an iteration's lines
+	// keeps those, the last finished iteration's fill in the rest
+	std::vector<pv_line> lines;
+	search_stats stats;
+	std::vector<thread_stats> threads; // one per thread, the main thread first
+};
+
+// a search running on its own thread, see chess::search_async
+// destroying the handle stops the search and waits for it
+class search_handle {
+	std::future<search_result> result;
+	std::jthread worker; // after result, so it is joined before the future goes away
+
+public:
+	search_handle(std::future<search_result> result, std::jthread worker) : result(std::move(result)),
+	                                                                        worker(std::move(worker)) {}
+
+	// asks the search to stop, it finishes the node it is on and hands back the best move it has
+	void stop() { worker.request_stop(); }
+	[[nodiscard]] bool ready() const { return result.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }
+	// waits for the search, only once
+	[[nodiscard]] search_result get() { return result.get(); }
+};
 
 class chess {
-	table_bundle tables;
+	// well above any evaluation, below INT_MAX so it can be negated; being mated n plies from the root scores
+	// -MATE_SCORE + n
+	static constexpr int MATE_SCORE = 1000000;
+
+	// delta pruning: a capture is skipped if even winning the piece plus this margin can't raise alpha
+	static constexpr int DELTA_MARGIN = 200;
+
+	// iterative deepening searches from this depth on in a window this wide either side of the last score
+	static constexpr int ASPIRATION_DEPTH = 4;
+	static constexpr int ASPIRATION_WINDOW = 50;
+
+	// null move pruning is only tried this far from the horizon
+	static constexpr int NULL_MOVE_MIN_DEPTH = 3;
+	// late move reductions start after this many moves, from this depth on
+	static constexpr int LMR_MIN_MOVES = 3;
+	static constexpr int LMR_MIN_DEPTH = 3;
+
+	// ybwc only splits nodes at least this far from the horizon, smaller ones aren't worth handing over
+	static constexpr int SPLIT_MIN_DEPTH = 4;
+
+	const table_bundle *tables{&table_bundle::shared()}; // built once per process and shared by every game
 
 	game_data gd;
 
+	static constexpr size_t DEFAULT_HASH_MB = 16;
+	transposition_table tt; // allocated by the first search unless set_hash_size was called
+
 	piece_color p1_color;
 	piece_color p2_color;
 
 	bool check_move(int old_idx, int new_idx, game_data &search_gd) const;
 
-	int negamax(game_data pseudo_gd, piece_color color, int depth, int alpha, int beta);
+	struct split_point;
+
+	// triangular pv array: row ply holds the best line from ply on, built from the row below whenever a move raises
+	// alpha, so row 0 ends up with the whole line; negamax reaches ply MAX_PLY at the horizon, hence the extra row
+	struct pv_table {
+		static constexpr int SIZE = move_history::MAX_PLY + 1;
+		std::array<std::array<chess_move, SIZE>, SIZE> moves{};
+		std::array<int, SIZE> length{};
+
+		// move raised alpha at ply, line (line_length moves) is what follows it
+		void update(const int ply, const chess_move move, const chess_move *line, const int line_length) {
+			moves[ply][0] = move;
+			std::copy_n(line, line_length, moves[ply].begin() + 1);
+			length[ply] = line_length + 1;
+		}
+
+		void update(const int ply, const chess_move move) { update(ply, move, moves[ply + 1].data(), length[ply + 1]); }
+	};
+
+	// what one search owns: the board it moves in place and the state for its limits
+	struct search_context {
+		game_data board;
+		undo_stack stack;
+		search_limits limits;
+		std::chrono::steady_clock::time_point start;
+		uint64_t nodes{0};
+		bool stopped{false}; // set once a hard limit is hit, every score after that is meaningless
+		chess_move root_move{}; // best move found so far in the current iteration
+		move_history history; // killers and history, kept across iterations
+		search_stats stats; // only the counters, nodes is copied over from above at the end
+		int multi_pv{1}; // root moves to find a line for
+		move_list excluded_root_moves; // moves the current multi-pv line has to leave out
+		pv_table pv;
+		std::vector<chess_move> seed; // the last search's line from this root on, tried first where the table has none
+		int seed_ply{0}; // how far down seed the current node is, it is off the line below this
+		// stops the search once set, how helper threads are ended and how a stop reaches every ybwc brother
+		std::atomic<bool> *abort{nullptr};
+		std::stop_token stop; // the caller's stop, for searches started by search_async and ponder
+
+		// ybwc only
+		work_stealing_pool *pool{nullptr};
+		search_stats *pool_stats{nullptr}; // indexed by pool thread, what it searched for split nodes
+		const split_point *split{nullptr}; // the split this search is a brother under, the main search has none
+		int thread{0}; // the pool thread running this search
+		std::atomic<uint64_t> *shared_nodes{nullptr}; // every thread's nodes, what the node limit is checked against
+		uint64_t reported_nodes{0}; // the part of nodes already added to shared_nodes
+
+		// every search needs these four, the rest starts from the defaults above
+		search_context(const game_data &board, const search_limits &limits,
+		               const std::chrono::steady_clock::time_point start, std::stop_token stop)
+			: board(board), limits(limits), start(start), stop(std::move(stop)) { stack.reserve(MAX_DEPTH); }
+	};
+
+	// a node whose younger brothers are searched in parallel, it lives on the owner's stack until every brother is done
+	struct split_point {
+		const search_context *parent; // the owner, its board is left at the node until the split is over
+		piece_color color;
+		int depth;
+		int ply;
+		int beta;
+		bool in_check;
+		std::atomic<int> alpha; // raised as brothers finish, later brothers start from the newest value
+		std::atomic<int> pending; // brothers not finished yet
+
+		std::atomic<bool> cutoff{false}; // a brother failed high, every search under this node can stop
+		std::atomic<bool> stopped{false}; // a brother hit a hard limit
+
+		std::mutex mutex; // guards the best score and move
+		int best_score{INT_MIN};
+		chess_move best_move{};
+		std::vector<chess_move> best_line; // what follows best_move, from the brother's pv
+
+		split_point(const search_context *parent, const piece_color color, const int depth, const int ply,
+		            const int beta, const bool in_check, const int alpha, const int pending)
+			: parent(parent), color(color), depth(depth), ply(ply), beta(beta), in_check(in_check), alpha(alpha),
+			  pending(pending) {}
+	};
+
+	struct split_result {
+		int score; // INT_MIN if there were no brothers left
+		chess_move best_move;
+		int moves;
+		std::vector<chess_move> line;
+	};
+
+	int thread_count{1};
+	parallel_mode parallelism{parallel_mode::LAZY_SMP};
+	int multi_pv_lines{1};
+	std::vector<thread_stats> thread_report;
+	search_stats last_stats;
+	// the last search's principal variation and the hash of the position before each of its moves, so a later search
+	// from anywhere along it can pick the line up (see search_context::seed)
+	std::vector<chess_move> last_pv;
+	std::vector<uint64_t> last_pv_keys;
+
+	// checks the hard limits, the clock only every 1024 nodes
+	static void check_limits(search_context &context);
+	// the stops and hard limits alone, without the cutoffs of the splits above; check_clock reads the time every call
+	[[nodiscard]] static bool limit_reached(search_context &context, bool check_clock);
+	// adds the nodes searched since the last report to context.shared_nodes
+	static void report_nodes(search_context &context);
+
+	// the table is shared by nodes at any ply, so a mate is stored counted from the node rather than the root
+	[[nodiscard]] static int score_to_table(int score, int ply);
+	[[nodiscard]] static int score_from_table(int score, int ply);
+
+	// null_move_allowed is false straight after a null move, so two passes in a row can't cancel out
+	int negamax(search_context &context, piece_color color, int depth, int ply, int alpha, int beta,
+	            bool null_move_allowed = true);
+	// captures only from the horizon on (every move while in check), so leaves are scored once things are quiet
+	int quiescence(search_context &context, piece_color color, int ply, int alpha, int beta);
+	// the static evaluation for color
+	float evaluate(search_context &context, piece_color color) const;
+
+	// makes, searches (pvs and late move reductions) and takes back one move of a negamax node, move_number counts
+	// from 1 in the order the moves were picked
+	int search_move(search_context &context, piece_color color, chess_move move, int move_number, int depth, int ply,
+	                int alpha, int beta, bool in_check);
+	// searches every move left in picker on the pool and waits for them, helping with its own
+	split_result split_search(search_context &context, move_picker &picker, piece_color color, int depth, int ply,
+	                          int alpha, int beta, bool in_check, int moves_searched);
+	// one younger brother of split, run by whichever pool thread got the task
+	void run_brother(split_point &split, chess_move move, int move_number, int thread);
+
+	// searches depth 1, 2, 3... (each plus depth_offset) until context's limits or max_depth, returns the best move
+	// of the last finished iteration
+	search_result iterative_deepening(search_context &context, int max_depth, int depth_offset);
+	// searches the root at depth in a window around guess, widening it until the score lands inside, the move is
+	// left in context.root_move; a move that failed high is kept in fail_high_move in case the search is cut off
+	int aspiration_search(search_context &context, int depth, int guess, chess_move &fail_high_move);
+	[[nodiscard]] static bool is_excluded(const search_context &context, chess_move move);
+	// the pv of the root searched last, carried on from the table's best moves where a table cutoff ended it early,
+	// up to max_length moves
+	[[nodiscard]] std::vector<chess_move> principal_variation(const search_context &context, int max_length) const;
+	// the seed move for ply, the null move once the node is off the seed line
+	[[nodiscard]] static chess_move seed_move(const search_context &context, int ply);
+	// keeps result's best line for the next search to seed from, only after searches on the calling thread
+	void remember_pv(const game_data &root, const search_result &result);
+
+	// allocates the transposition table on first use and starts a new generation, before each search
+	void prepare_table();
+	// searches root for its side to move on as many threads as set, without touching gd or the last search's reports
+	search_result search(const game_data &root, const search_limits &limits, const std::stop_token &stop);
+	search_handle start_search(game_data root, const search_limits &limits, const std::stop_token &stop);
 
 public:
 	explicit chess(const std::string &fen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR");
 
-	sb get_valid_moves(const int pos) { return gd.get_valid_moves(pos, tables.lookup_table, tables.between_table); }
+	sb get_valid_moves(const int pos) { return gd.get_valid_moves(pos, tables->lookup_table, tables->between_table); }
 	bool check_move(const int old_idx, const int new_idx) { return check_move(old_idx, new_idx, gd); };
 
-	void ai_move(int depth);
+	// every legal move for the side to move, packed (see chess_move)
+	[[nodiscard]] move_list get_legal_moves();
+
+	static constexpr int MAX_DEPTH = 64;
+	static_assert(MAX_DEPTH <= move_history::MAX_PLY, "negamax keeps killers for every ply it reaches");
+
+	// searches depth 1, 2, 3... until a limit is hit, then plays the best move of the last finished iteration
+	// returns the move played (the null move if there wasn't one)
+	chess_move ai_move(const search_limits &limits);
+	chess_move ai_move(const int depth) { return ai_move(search_limits{.depth = depth}); }
+
+	// searches the position for its side to move and hands back the best move, score and principal variation (in
+	// search_result::lines) without playing anything, for hints and analysis
+	[[nodiscard]] search_result analyze(const search_limits &limits);
+	[[nodiscard]] search_result analyze(const int depth) { return analyze(search_limits{.depth = depth}); }
+
+	// starts the same search as ai_move on another thread and returns straight away, the move is not played
+	// stop comes from the caller (as well as search_handle::stop), gd may change while the search runs but nothing
+	// else that searches may be called on this game until the handle is done
+	[[nodiscard]] search_handle search_async(const search_limits &limits, const std::stop_token &stop = {});
+
+	// the opponent's reply the last search expected, the null move if the table doesn't know one
+	[[nodiscard]] chess_move expected_reply() const;
+	// searches the ai's answer to reply with no limits during the opponent's time, until the handle is stopped
+	// the result is only worth anything if the opponent does play reply, but either way the transposition table is
+	// left full of the position, so the next ai_move gets deep quickly; with the null move (or a reply that isn't
+	// legal) the opponent's own choices are searched instead
+	[[nodiscard]] search_handle ponder(chess_move reply);
+
+	// size of the transposition table in MB, clears it
+	void set_hash_size(const size_t megabytes) { tt.resize(megabytes); }
+
+	// threads used by ai_move, 1 searches on the calling thread only
+	// node limits count the main thread's nodes with lazy smp (the other threads stop when it does) and every
+	// thread's with ybwc
+	void set_threads(const int threads) { thread_count = std::max(threads, 1); }
+	[[nodiscard]] int get_threads() const { return thread_count; }
+	void set_parallel_mode(const parallel_mode mode) { parallelism = mode; }
+
+	// how many of the best root moves a search reports in search_result::lines, each searched with its own window
+	// after the ones before it are left out; ai_move still plays the best
+	void set_multi_pv(const int lines) { multi_pv_lines = std::max(lines, 1); }
+
+	// node throughput of each thread in the last ai_move or analyze, the main thread first
+	// search_async and ponder leave this and get_search_stats alone and hand theirs back in search_result, so both
+	// can be read while a handle runs
+	[[nodiscard]] const std::vector<thread_stats> &get_thread_stats() const { return thread_report; }
+	// what the last ai_move did
+	[[nodiscard]] const search_stats &get_search_stats() const { return last_stats; }
+	// the side ai_move, search_async and ponder's answer play
+	[[nodiscard]] piece_color get_ai_color() const { return p2_color; }
 
 	void move(const int old_pos, const int new_pos) {
-		gd.move(old_pos, new_pos, tables.lookup_table, tables.between_table);
+		gd.move(old_pos, new_pos, tables->lookup_table);
 	}
 
 	[[nodiscard]] std::string get_board() const { return gd.get(); };
-	void set_board(const std::string &fen) { gd.set(fen, tables.lookup_table, tables.between_table); };
+	void set_board(const std::string &fen) { gd.set(fen, tables->lookup_table); };
 
 	/* debugging functions
 	[[nodiscard]] sb get_table_lookup(const int pos) const {
 		sb result = 0;
-		for (int i = 0; i < 8; i++) result |= tables.lookup_table.queen_table[pos][i];
+		for (int i = 0; i < 8; i++) result |= tables->lookup_table.queen_table[pos][i];
 		return result;
 	}
 
 	[[nodiscard]] sb get_between_table(const int pos1, const int pos2) const {
-		return tables.between_table[pos1][pos2];
+		return tables->between_table[pos1][pos2];
 	}
 	*/
 };
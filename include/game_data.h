@@ -1,20 +1,62 @@
 #pragma once
 
 #include "types.h"
+#include "zobrist.h"
 
 #include <string>
+#include <vector>
 
-class game_data {
-	piece_data *ray_cast_x1(sb arm, const piece_data &piece);
-	std::pair<piece_data *, piece_data *> ray_cast_x2(sb arm, const piece_data &piece);
+// everything make_move changes that can't be worked out again from the move itself
+struct undo_record {
+	piece_data captured; // type is EMPTY if nothing was captured
+	sb en_passant_board;
+	std::array<sb, 2> side_attacks;
+	std::array<std::array<sb, 16>, 2> attacks; // indexed by piece_color then piece id
+	piece_color side_to_move;
+	uint64_t hash_key;
+	int halfmove_clock;
+	bool had_moved;
+	bool rook_had_moved; // only used when castling
+};
+
+// one record per move made, reserve the search depth up front so pushing never allocates
+using undo_stack = std::vector<undo_record>;
 
+// check and pin information for the side to move, worked out once per position (see game_data::get_position_masks)
+struct position_masks {
+	sb checkers; // enemy pieces giving check
+	sb evasion_mask; // where a non-king piece may go: anywhere, the checker or its arm, or nowhere in double check
+	sb pinned; // friendly pieces pinned to their king
+	std::array<sb, 64> pin_rays; // the line a pinned piece must stay on, only set for the squares in pinned
+};
+
+class game_data {
 	sb pawn_logic(const piece_data &piece);
 	sb king_logic(const piece_data &piece, int pos, const lookup_tables &lookup_table);
-	sb slider_logic(const piece_data &piece, const lookup_tables &lookup_table,
-	                const between_tables &between_table);
+	sb slider_logic(const piece_data &piece, const lookup_tables &lookup_table);
 
-	void update_attack_boards(const lookup_tables &lookup_table, const between_tables &between_table);
-	void update_pins(auto &piece_set, const auto &table);
+	[[nodiscard]] sb piece_attacks(const piece_data &piece, const lookup_tables &lookup_table) const;
+
+	// rebuilds every attack board from scratch
+	void update_attack_boards(const lookup_tables &lookup_table);
+	// only recomputes the pieces affected by the squares in changed, then rebuilds side_attacks from the cache
+	void update_attack_boards(sb changed, const lookup_tables &lookup_table);
+
+	// true if taking en passant from from_idx would leave the king open along the rank both pawns leave
+	[[nodiscard]] bool en_passant_exposes_king(int from_idx, piece_color color,
+	                                           const lookup_tables &lookup_table) const;
+
+	// moves a piece between squares, keeping the boards and piece_lookup in step
+	void relocate(piece_data &piece, int from_idx, int to_idx);
+
+	uint64_t hash_key{0}; // kept up to date by move, see hash()
+	[[nodiscard]] uint64_t compute_hash() const;
+
+	// keys of the positions before this one, a ring so the oldest are overwritten first; big enough for fifty moves
+	// (after which the game is drawn anyway) plus a full search on top
+	static constexpr int KEY_HISTORY_SIZE = 256;
+	std::array<uint64_t, KEY_HISTORY_SIZE> key_history{};
+	int history_count{0}; // keys pushed since set, the last one is at (history_count - 1) % KEY_HISTORY_SIZE
 
 public:
 	sb white_board{};
@@ -23,14 +65,17 @@ public:
 	std::array<uint8_t, 64> piece_lookup{};
 	std::array<piece_data, 16> white_pieces; // the last piece must be king
 	std::array<piece_data, 16> black_pieces; // the last piece must be king
+	std::array<std::array<sb, 6>, 2> piece_boards{}; // indexed by piece_color then piece_type
 	std::array<sb, 2> side_attacks{};
+	piece_color side_to_move{piece_color::WHITE}; // the color of the pieces that didn't make the last move
+	int halfmove_clock{0}; // plies since the last capture or pawn move, the fifth field of the fen
 
-	explicit game_data(const std::string &fen, const lookup_tables &lookup_table, const between_tables &between_table) {
-		set(fen, lookup_table, between_table);
+	explicit game_data(const std::string &fen, const lookup_tables &lookup_table) {
+		set(fen, lookup_table);
 	}
 
 	[[nodiscard]] std::string get() const;
-	void set(const std::string &fen, const lookup_tables &lookup_table, const between_tables &between_table);
+	void set(const std::string &fen, const lookup_tables &lookup_table);
 
 	static int sb_to_int(const sb board) { return __builtin_ctzll(board); }
 
@@ -39,8 +84,61 @@ public:
 	[[nodiscard]] std::pair<sb *, sb *> get_boards(piece_color color);
 	[[nodiscard]] std::pair<std::array<piece_data, 16> *, std::array<piece_data, 16> *> get_pieces(piece_color color);
 
-	[[nodiscard]] float evaluate_position(const lookup_tables &lookup_table, const between_tables &between_table);
+	// Zobrist key of the pieces, side to move, castling rights and en passant file
+	[[nodiscard]] uint64_t hash() const { return hash_key; }
+
+	// castling rights (see zobrist.h) for every king and rook still on their starting squares that haven't moved
+	[[nodiscard]] uint8_t castling_rights() const;
 
+	// a position seen before since the last capture or pawn move; a single repetition is enough for the search, the
+	// side that repeated once can always do it again
+	[[nodiscard]] bool is_repetition() const;
+	// fifty moves without a capture or pawn move, unless the move that got there mated, which takes the side to
+	// move's moves to tell
+	[[nodiscard]] bool fifty_moves() const { return halfmove_clock >= 100; }
+	// either of the above, without looking for a mate
+	[[nodiscard]] bool is_draw() const { return fifty_moves() || is_repetition(); }
+
+	// use this rather than writing side_to_move directly so the hash follows
+	void set_side_to_move(const piece_color color) {
+		if (color != side_to_move) { hash_key ^= zobrist.black_to_move; }
+		side_to_move = color;
+	}
+
+	// false if color has only its king and pawns, where passing would often be the best move (zugzwang)
+	[[nodiscard]] bool has_non_pawn_material(const piece_color color) const {
+		const auto &boards{piece_boards[static_cast<int>(color)]};
+		return boards[static_cast<int>(piece_type::BISHOP)] | boards[static_cast<int>(piece_type::KNIGHT)]
+		       | boards[static_cast<int>(piece_type::ROOK)] | boards[static_cast<int>(piece_type::QUEEN)];
+	}
+
+	[[nodiscard]] bool in_check(const piece_color color) const {
+		const sb king{color == piece_color::WHITE ? white_pieces[15].position : black_pieces[15].position};
+		return side_attacks[1 - static_cast<int>(color)] & king;
+	}
+
+	[[nodiscard]] float evaluate_position(const lookup_tables &lookup_table);
+
+	// every piece of either color attacking pos, with sliders blocked by occupied
+	[[nodiscard]] sb attackers_to(int pos, sb occupied, const lookup_tables &lookup_table) const;
+	[[nodiscard]] position_masks get_position_masks(piece_color color, const lookup_tables &lookup_table,
+	                                                const between_tables &between_table) const;
+
+	// moves that follow the piece's own rules (kings still avoid attacked squares), without pins or checks
+	[[nodiscard]] sb get_pseudo_moves(int pos, const lookup_tables &lookup_table);
+	// pseudo moves narrowed by masks, so only a single AND per piece once the masks are known
+	[[nodiscard]] sb get_legal_moves(int pos, const position_masks &masks, const lookup_tables &lookup_table);
+	// pins and king safety, but not check evasion
 	[[nodiscard]] sb get_valid_moves(int pos, const lookup_tables &lookup_table, const between_tables &between_table);
-	void move(int old_idx, int new_idx, const lookup_tables &lookup_table, const between_tables &between_table);
+	void move(int old_idx, int new_idx, const lookup_tables &lookup_table);
+
+	// move in place for the search, pushing what's needed to take it back onto stack
+	void make_move(chess_move move, undo_stack &stack, const lookup_tables &lookup_table);
+	// takes back the last make_move (must be given the same move)
+	void unmake_move(chess_move move, undo_stack &stack);
+
+	// passes the turn without moving anything (null move pruning), the side to move must not be in check
+	// positions before the pass don't count as repetitions until it is taken back
+	void make_null_move(undo_stack &stack);
+	void unmake_null_move(undo_stack &stack);
 };
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "game_data.h"
+#include "types.h"
+
+// fills list with every legal move for gd.side_to_move in one pass
+// checks and pins are worked out once for the position (see game_data::get_position_masks), not once per move
+void generate_legal_moves(game_data &gd, move_list &list, const lookup_tables &lookup_table,
+                          const between_tables &between_table);
+
+// what the search learns about quiet moves, used by move_picker to order them
+// written on every beta cutoff, so each search (and later each search thread) keeps its own
+struct move_history {
+	static constexpr int MAX_PLY = 64;
+	// history scores are halved once one passes this, so recent cutoffs outweigh old ones
+	static constexpr int HISTORY_MAX = 1 << 14;
+
+	std::array<std::array<chess_move, 2>, MAX_PLY> killers{}; // the last two quiet moves to cut off at each ply
+	std::array<std::array<std::array<int, 64>, 64>, 2> butterfly{}; // indexed by piece_color, from then to
+
+	// records a quiet move that caused a beta cutoff, deeper cutoffs count for more
+	void record_cutoff(piece_color color, int ply, chess_move move, int depth);
+	void clear();
+};
+
+// the legal target squares of each piece of a position, so a piece is only generated once however many stages
+// look at it
+struct target_cache {
+	std::array<sb, 64> targets; // indexed by square, only set for the squares in known
+	sb known{0};
+};
+
+// hands out the legal moves for gd.side_to_move a stage at a time: the hash move, then captures (most valuable
+// victim first, then least valuable attacker), then quiet moves (killers first, then by history)
+// a stage is only generated once the one before it runs out, so a cutoff early on never pays for the quiet moves
+// gd may be changed between calls to next as long as it is back in the same position (make then unmake)
+class move_picker {
+	enum class stage : uint8_t {
+		HASH_MOVE,
+		GENERATE_CAPTURES,
+		CAPTURES,
+		GENERATE_QUIETS,
+		QUIETS,
+		DONE
+	};
+
+	game_data &gd;
+	const lookup_tables &lookup_table;
+	position_masks masks;
+	target_cache targets; // shared by the hash move check and both stages, each only keeps what it needs
+
+	chess_move hash_move;
+	bool captures_only;
+	const move_history *history;
+	int ply;
+	stage current_stage{stage::HASH_MOVE};
+	move_list moves;
+	std::array<int, 256> scores; // ordering scores, parallel to moves
+	int index{0};
+
+	[[nodiscard]] bool is_hash_move_legal();
+	// MVV-LVA, the most valuable victim first and the least valuable attacker among equal victims
+	void score_captures();
+	// killers above everything else, then the butterfly history
+	void score_quiets();
+	// swaps the best scored move left into index (a selection sort done one step at a time, since a cutoff usually
+	// comes before the list is used up)
+	void pick_best();
+
+public:
+	// hash_move is tried first if it is legal here, pass the null move when there isn't one
+	// captures_only stops after the captures (quiescence search)
+	// without a history the quiet moves come out in generation order
+	move_picker(game_data &gd, chess_move hash_move, const lookup_tables &lookup_table,
+	            const between_tables &between_table, bool captures_only = false, const move_history *history = nullptr,
+	            int ply = 0);
+
+	// the next move, or the null move once every stage is used up
+	[[nodiscard]] chess_move next();
+};
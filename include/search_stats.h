@@ -0,0 +1,81 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+
+// build with CHESS_SEARCH_STATS (cmake -DCHESS_SEARCH_STATS=ON) to collect everything below, otherwise only nodes,
+// nodes_per_second, depth and cut_brothers are filled in and the search carries no other counters or timers
+#ifdef CHESS_SEARCH_STATS
+inline constexpr bool SEARCH_STATS_ENABLED{true};
+#else
+inline constexpr bool SEARCH_STATS_ENABLED{false};
+#endif
+
+// how one search spent its time, summed over every thread that took part
+struct search_stats {
+	// always filled in
+	uint64_t nodes{0}; // negamax and quiescence nodes
+	double nodes_per_second{0};
+	int depth{0}; // the last iteration that finished
+	uint64_t cut_brothers{0}; // ybwc brothers stopped part way because another brother of their split failed high
+
+	// only with CHESS_SEARCH_STATS
+	uint64_t quiescence_nodes{0};
+	int seldepth{0}; // the deepest ply reached, quiescence included
+	uint64_t expanded_nodes{0}; // negamax nodes that got as far as searching a move
+	uint64_t beta_cutoffs{0};
+	uint64_t first_move_cutoffs{0}; // beta cutoffs on the first move searched
+	uint64_t tt_probes{0};
+	uint64_t tt_hits{0};
+	uint64_t tt_cutoffs{0}; // hits that ended the node without searching it
+	std::chrono::nanoseconds movegen_time{0}; // position masks and move_picker
+	std::chrono::nanoseconds eval_time{0};
+	std::chrono::nanoseconds move_time{0}; // making and taking back moves (game_data::move underneath)
+
+	// share of expanded nodes that failed high
+	[[nodiscard]] double cutoff_rate() const {
+		return expanded_nodes ? static_cast<double>(beta_cutoffs) / static_cast<double>(expanded_nodes) : 0;
+	}
+
+	// share of cutoffs that came from the first move, how good the move ordering is
+	[[nodiscard]] double first_move_cutoff_rate() const {
+		return beta_cutoffs ? static_cast<double>(first_move_cutoffs) / static_cast<double>(beta_cutoffs) : 0;
+	}
+
+	// adds another thread's counters, nodes_per_second and depth are left to the caller
+	search_stats &operator+=(const search_stats &other) {
+		nodes += other.nodes;
+		cut_brothers += other.cut_brothers;
+		quiescence_nodes += other.quiescence_nodes;
+		seldepth = std::max(seldepth, other.seldepth);
+		expanded_nodes += other.expanded_nodes;
+		beta_cutoffs += other.beta_cutoffs;
+		first_move_cutoffs += other.first_move_cutoffs;
+		tt_probes += other.tt_probes;
+		tt_hits += other.tt_hits;
+		tt_cutoffs += other.tt_cutoffs;
+		movegen_time += other.movegen_time;
+		eval_time += other.eval_time;
+		move_time += other.move_time;
+		return *this;
+	}
+};
+
+// adds the time until it goes out of scope to total, compiled away without CHESS_SEARCH_STATS
+class stats_timer {
+	std::chrono::nanoseconds &total;
+	std::chrono::steady_clock::time_point start;
+
+public:
+	explicit stats_timer(std::chrono::nanoseconds &total) : total(total) {
+		if constexpr (SEARCH_STATS_ENABLED) { start = std::chrono::steady_clock::now(); }
+	}
+
+	~stats_timer() {
+		if constexpr (SEARCH_STATS_ENABLED) { total += std::chrono::steady_clock::now() - start; }
+	}
+
+	stats_timer(const stats_timer &) = delete;
+	stats_timer &operator=(const stats_timer &) = delete;
+};
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "types.h"
+
+// set-wise attack generation, working on whole piece sets at once instead of one piece at a time
+// (no lookups, so these are also what the compact board uses)
+
+// file masks (bit 0 is h1, bit 7 is a1)
+constexpr sb not_a_file{~0x8080808080808080ULL};
+constexpr sb not_h_file{~0x0101010101010101ULL};
+constexpr sb not_ab_file{~0xC0C0C0C0C0C0C0C0ULL};
+constexpr sb not_gh_file{~0x0303030303030303ULL};
+
+// four boards handled together; GCC and Clang lower this to SSE2 (2 lanes) or AVX2 (4 lanes) when available
+using sb4 = sb __attribute__((vector_size(32)));
+
+inline sb pawn_attacks(const sb pawns, const piece_color color) {
+	return color == piece_color::WHITE
+		       ? ((pawns << 9) & not_h_file) | ((pawns << 7) & not_a_file)
+		       : ((pawns >> 9) & not_a_file) | ((pawns >> 7) & not_h_file);
+}
+
+// destinations of every pawn move of one color, the pawn that makes a move is always the same step back from it
+struct pawn_move_sets {
+	sb single_pushes;
+	sb double_pushes;
+	sb a_side_captures; // toward the a-file, en passant included
+	sb h_side_captures; // toward the h-file, en passant included
+
+	// to - from for each set
+	int push_step;
+	int a_side_step;
+	int h_side_step;
+};
+
+// all pushes and captures for a color in one pass of shifts, en_passant_target is the square behind a pawn that just
+// double moved (0 if there isn't one)
+inline pawn_move_sets pawn_moves(const sb pawns, const piece_color color, const sb empty, const sb enemy,
+                                 const sb en_passant_target) {
+	const sb targets{enemy | en_passant_target};
+
+	if (color == piece_color::WHITE) {
+		const sb single_pushes{pawns << 8 & empty};
+		return {
+			single_pushes, (single_pushes & 0x0000000000FF0000ULL) << 8 & empty,
+			(pawns << 9) & not_h_file & targets, (pawns << 7) & not_a_file & targets,
+			8, 9, 7
+		};
+	}
+
+	const sb single_pushes{pawns >> 8 & empty};
+	return {
+		single_pushes, (single_pushes & 0x0000FF0000000000ULL) >> 8 & empty,
+		(pawns >> 7) & not_h_file & targets, (pawns >> 9) & not_a_file & targets,
+		-8, -7, -9
+	};
+}
+
+inline sb knight_attacks(const sb knights) {
+	return ((knights << 17) & not_h_file) | ((knights << 15) & not_a_file)
+	       | ((knights << 10) & not_gh_file) | ((knights << 6) & not_ab_file)
+	       | ((knights >> 17) & not_a_file) | ((knights >> 15) & not_h_file)
+	       | ((knights >> 10) & not_ab_file) | ((knights >> 6) & not_gh_file);
+}
+
+inline sb king_attacks(const sb kings) {
+	const sb sides{kings | ((kings << 1) & not_h_file) | ((kings >> 1) & not_a_file)};
+	return (sides | sides << 8 | sides >> 8) & ~kings;
+}
+
+// occluded fill (Kogge-Stone) for all 8 directions, rook directions use rooks and bishop directions use bishops
+// (queens go in both); attacks stop at and include the first occupied square, like slider_tables
+inline sb sliding_attacks(const sb rooks, const sb bishops, const sb empty) {
+	// lanes are left (+1), up-left (+9), up (+8), up-right (+7); the down lanes are the same shifts the other way
+	constexpr sb4 shift_1{1, 9, 8, 7};
+	constexpr sb4 shift_2{2, 18, 16, 14};
+	constexpr sb4 shift_4{4, 36, 32, 28};
+	constexpr sb4 up_wrap{not_h_file, not_h_file, ~sb{0}, not_a_file};
+	constexpr sb4 down_wrap{not_a_file, not_a_file, ~sb{0}, not_h_file};
+
+	const sb4 gen{rooks, bishops, rooks, bishops};
+	const sb4 empty4{empty, empty, empty, empty};
+
+	// up
+	sb4 up_gen{gen};
+	sb4 up_pro{empty4 & up_wrap};
+	up_gen |= up_pro & (up_gen << shift_1);
+	up_pro &= up_pro << shift_1;
+	up_gen |= up_pro & (up_gen << shift_2);
+	up_pro &= up_pro << shift_2;
+	up_gen |= up_pro & (up_gen << shift_4);
+
+	// down
+	sb4 down_gen{gen};
+	sb4 down_pro{empty4 & down_wrap};
+	down_gen |= down_pro & (down_gen >> shift_1);
+	down_pro &= down_pro >> shift_1;
+	down_gen |= down_pro & (down_gen >> shift_2);
+	down_pro &= down_pro >> shift_2;
+	down_gen |= down_pro & (down_gen >> shift_4);
+
+	const sb4 attacks{((up_gen << shift_1) & up_wrap) | ((down_gen >> shift_1) & down_wrap)};
+	return attacks[0] | attacks[1] | attacks[2] | attacks[3];
+}
+
+// everything one side attacks; piece_boards is indexed by piece_type
+// enemy_king is removed from the occupancy so sliders see through it (the king can't step back along the arm)
+inline sb side_attacks_setwise(const std::array<sb, 6> &piece_boards, const piece_color color, const sb occupied,
+                               const sb enemy_king) {
+	const sb queens{piece_boards[static_cast<int>(piece_type::QUEEN)]};
+	const sb rooks{piece_boards[static_cast<int>(piece_type::ROOK)] | queens};
+	const sb bishops{piece_boards[static_cast<int>(piece_type::BISHOP)] | queens};
+
+	return pawn_attacks(piece_boards[static_cast<int>(piece_type::PAWN)], color)
+	       | knight_attacks(piece_boards[static_cast<int>(piece_type::KNIGHT)])
+	       | king_attacks(piece_boards[static_cast<int>(piece_type::KING)])
+	       | sliding_attacks(rooks, bishops, ~(occupied & ~enemy_king));
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "types.h"
+
+#include <atomic>
+#include <memory>
+
+// how a stored score relates to the real one
+enum class bound_type : uint8_t {
+	NONE = 0,
+	EXACT = 1, // the search finished inside the window
+	LOWER = 2, // failed high, the real score is at least this
+	UPPER = 3 // failed low, the real score is at most this
+};
+
+// what a probe hands back
+struct tt_entry {
+	int score;
+	chess_move best_move; // the null move if the search didn't find one (a fail low)
+	int depth;
+	bound_type bound;
+};
+
+// hash table of search results keyed by game_data::hash, shared between search threads without locks
+// each slot holds the key XORed with its data, so a slot torn by two threads writing at once fails the key check on
+// the next probe and is just treated as a miss
+class transposition_table {
+	struct slot {
+		std::atomic<uint64_t> key; // position key ^ data
+		std::atomic<uint64_t> data; // see pack
+	};
+
+	// one cache line per bucket, so a probe touches a single line
+	struct alignas(64) bucket {
+		std::array<slot, 4> slots;
+	};
+
+	std::unique_ptr<bucket[]> buckets;
+	size_t bucket_count{0};
+	uint8_t generation{0}; // bumped every search so entries from old searches are replaced first
+
+	// score in the low 32 bits, then move (16), depth (8), bound (2) and generation (6)
+	[[nodiscard]] static uint64_t pack(int score, chess_move best_move, int depth, bound_type bound, uint8_t age);
+
+	[[nodiscard]] bucket &bucket_for(const uint64_t key) const {
+		// multiply and keep the high half, maps the key onto any table size without a modulo
+		return buckets[static_cast<size_t>((static_cast<unsigned __int128>(key) * bucket_count) >> 64)];
+	}
+
+public:
+	transposition_table() = default;
+
+	explicit transposition_table(const size_t megabytes) { resize(megabytes); }
+
+	// reallocates (and clears) the table, 0 frees it; not safe while a search is using it
+	void resize(size_t megabytes);
+	void clear();
+
+	[[nodiscard]] bool empty() const { return bucket_count == 0; }
+	[[nodiscard]] size_t size_bytes() const { return bucket_count * sizeof(bucket); }
+
+	// call once before each search
+	void new_search() { generation = (generation + 1) & 0x3F; }
+
+	[[nodiscard]] bool probe(uint64_t key, tt_entry &entry) const;
+	void store(uint64_t key, int depth, int score, bound_type bound, chess_move best_move);
+};
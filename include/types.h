@@ -1,7 +1,15 @@
 #pragma once
 
 #include <array>
+#include <cstddef>
 #include <cstdint>
+#include <span>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#include <immintrin.h>
+#define CHESS_HAS_PEXT 1
+#endif
 
 using sb = uint64_t; // represents each square on the board as a single bit
 
@@ -17,25 +25,29 @@ enum class piece_type : int {
 	EMPTY = -1
 };
 
+// piece_data::value of the pieces the search needs on their own: what an en passant capture takes, and the most any
+// single capture can win
+inline constexpr int PAWN_VALUE{100};
+inline constexpr int QUEEN_VALUE{900};
+
 struct piece_data {
 	sb position; // the board representing the position of the piece
 	sb attacks; // the board representing all attacks of a piece
 	piece_type type;
 	piece_color color;
 	uint8_t id; // the position of the piece in the piece arrays
-	uint8_t pinner_id; // the id if the piece pinning this piece... 255 if no pin
 	bool is_slider;
 	bool has_moved;
 	int value;
 
 	piece_data(const uint64_t position, const piece_type type, const piece_color color,
 	           const uint8_t id) : position(position), attacks(0), type(type), color(color), id(id),
-	                               pinner_id(255), is_slider(false), has_moved(false), value(0) {
+	                               is_slider(false), has_moved(false), value(0) {
 		if (type == piece_type::BISHOP || type == piece_type::ROOK || type == piece_type::QUEEN) { is_slider = true; }
 
 		switch (type) {
 			case piece_type::PAWN: {
-				value = 100;
+				value = PAWN_VALUE;
 				break;
 			}
 			case piece_type::BISHOP: {
@@ -53,7 +65,7 @@ struct piece_data {
 				break;
 			}
 			case piece_type::QUEEN: {
-				value = 900;
+				value = QUEEN_VALUE;
 				is_slider = true;
 				break;
 			}
@@ -65,7 +77,7 @@ struct piece_data {
 		}
 	}
 
-	piece_data() : position(0), attacks(0), type(piece_type::EMPTY), color(piece_color::NONE), id(255), pinner_id(255),
+	piece_data() : position(0), attacks(0), type(piece_type::EMPTY), color(piece_color::NONE), id(255),
 	               is_slider(false), value(0) {};
 
 	void set(const uint64_t position, const piece_type type, const piece_color color, const uint8_t id) {
@@ -109,16 +121,129 @@ struct piece_data {
 		position = attacks = 0;
 		type = piece_type::EMPTY;
 		color = piece_color::NONE;
-		pinner_id = 255;
 		is_slider = false;
 		value = 0;
 	}
 };
 
+// flags stored in the top 4 bits of a chess_move
+enum class move_flag : uint8_t {
+	QUIET = 0,
+	DOUBLE_PUSH = 1,
+	CASTLE = 2,
+	CAPTURE = 4, // any flag with this bit set removes an enemy piece
+	EN_PASSANT = 5
+};
+
+// a move packed into 16 bits: from (bits 0-5), to (bits 6-11) and a move_flag (bits 12-15)
+struct chess_move {
+	// left uninitialized so move lists are free to construct, chess_move{} is the null move (0 is never a real
+	// move, from and to would be the same square)
+	uint16_t data;
+
+	chess_move() = default;
+
+	chess_move(const int from, const int to, const move_flag flag)
+		: data(static_cast<uint16_t>(from | to << 6 | static_cast<int>(flag) << 12)) {}
+
+	[[nodiscard]] int from() const { return data & 0x3F; }
+	[[nodiscard]] int to() const { return data >> 6 & 0x3F; }
+	[[nodiscard]] move_flag flag() const { return static_cast<move_flag>(data >> 12); }
+	[[nodiscard]] bool is_capture() const { return data & 0x4000; }
+	[[nodiscard]] bool is_null() const { return data == 0; }
+
+	bool operator==(const chess_move &other) const { return data == other.data; }
+};
+
+// fixed size move list, meant to live on the stack (no position has more than 218 legal moves)
+struct move_list {
+	std::array<chess_move, 256> moves;
+	int size{0};
+
+	void push(const chess_move move) { moves[size++] = move; }
+
+	[[nodiscard]] chess_move *begin() { return moves.data(); }
+	[[nodiscard]] chess_move *end() { return moves.data() + size; }
+	[[nodiscard]] const chess_move *begin() const { return moves.data(); }
+	[[nodiscard]] const chess_move *end() const { return moves.data() + size; }
+};
+
 template<size_t N>
 using lb = std::array<std::array<sb, N>, 64>;
 // represents the lookup table of length 64 for each square and N size for the number of arms
 
+// the way slider_tables turns an occupancy into a table index
+enum class slider_backend : int {
+	MAGIC = 0, // multiply by a magic number and shift, works everywhere
+	PEXT = 1 // BMI2 parallel bit extract, only fast on CPUs with a hardware PEXT
+};
+
+// slider attack tables, giving the full attack board of a square in one lookup
+// attacks stop at (and include) the first piece hit on each arm, no matter the color
+class slider_tables {
+	struct magic_entry {
+		sb mask; // the arms of the square without their last square (the relevant occupancy)
+		sb magic;
+		uint32_t offset; // the start of this square in the attack table
+		int shift;
+	};
+
+	slider_backend backend{slider_backend::MAGIC};
+	std::array<magic_entry, 64> bishop_magics{};
+	std::array<magic_entry, 64> rook_magics{};
+	std::vector<sb> attack_table;
+
+	static void init_magics(std::array<magic_entry, 64> &magics, const lb<4> &arm_table,
+	                        const std::array<sb, 64> &seed_magics, slider_backend table_backend,
+	                        std::vector<sb> &table);
+
+#ifdef CHESS_HAS_PEXT
+#ifdef __BMI2__
+	[[nodiscard]] sb pext_lookup(const magic_entry &entry, const sb occupancy) const {
+		return attack_table[entry.offset + _pext_u64(occupancy, entry.mask)];
+	}
+#else
+	// built for bmi2 on its own so the rest of the library still runs on older CPUs
+	[[nodiscard]] [[gnu::target("bmi2")]] sb pext_lookup(const magic_entry &entry, const sb occupancy) const {
+		return attack_table[entry.offset + _pext_u64(occupancy, entry.mask)];
+	}
+#endif
+#endif
+
+	[[nodiscard]] sb lookup(const magic_entry &entry, const sb occupancy) const {
+#ifdef CHESS_HAS_PEXT
+		if (backend == slider_backend::PEXT) { return pext_lookup(entry, occupancy); }
+#endif
+		return attack_table[entry.offset + ((occupancy & entry.mask) * entry.magic >> entry.shift)];
+	}
+
+public:
+	// picks PEXT if the CPU has BMI2, otherwise magics
+	// setting CHESS_SLIDER_BACKEND to "magic" or "pext" overrides this (see bench/slider_bench.cpp)
+	[[nodiscard]] static slider_backend detect_backend();
+
+	// builds the tables from the arm tables (arms must already be filled)
+	// asking for PEXT on a CPU without BMI2 falls back to magics
+	void init(const lb<4> &bishop_table, const lb<4> &rook_table, slider_backend requested = detect_backend());
+
+	[[nodiscard]] slider_backend get_backend() const { return backend; }
+
+	// walks the arms for a given occupancy, used to fill the tables and as a reference
+	static sb arm_attacks(std::span<const sb> arms, int pos, sb occupancy);
+
+	[[nodiscard]] sb bishop_attacks(const int pos, const sb occupancy) const {
+		return lookup(bishop_magics[pos], occupancy);
+	}
+
+	[[nodiscard]] sb rook_attacks(const int pos, const sb occupancy) const {
+		return lookup(rook_magics[pos], occupancy);
+	}
+
+	[[nodiscard]] sb queen_attacks(const int pos, const sb occupancy) const {
+		return bishop_attacks(pos, occupancy) | rook_attacks(pos, occupancy);
+	}
+};
+
 // each entry is indexed by a square (0-63), containing N arms.
 // arms are ordered: left, then clockwise
 struct lookup_tables {
@@ -127,6 +252,7 @@ struct lookup_tables {
 	lb<4> rook_table;
 	lb<8> queen_table;
 	lb<1> king_table;
+	slider_tables slider_table; // built from the bishop and rook arms
 };
 
 // arms between all two positions on the board including the start and end
@@ -134,10 +260,20 @@ struct lookup_tables {
 using between_tables = std::array<std::array<sb, 64>, 64>;
 
 // struct for the two game tables
+// these never change once built, so every game should use the one from shared() instead of building its own
 struct table_bundle {
 	between_tables between_table{};
 	lookup_tables lookup_table{};
 
+	// built once per process on first use (thread safe) and read only after that
+	static const table_bundle &shared() {
+		static const table_bundle tables;
+		return tables;
+	}
+
+	table_bundle(const table_bundle &) = delete;
+	table_bundle &operator=(const table_bundle &) = delete;
+
 	table_bundle() {
 		std::array<std::array<sb, 8>, 64> default_table{};
 
@@ -294,5 +430,8 @@ struct table_bundle {
 				}
 			}
 		}
+
+		// magic tables for the sliders
+		lookup_table.slider_table.init(lookup_table.bishop_table, lookup_table.rook_table);
 	}
 };
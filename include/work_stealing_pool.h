@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// a fixed set of worker threads that take tasks from each other
+// every thread, including the one that owns the pool (thread 0), has a deque: it pushes and pops its own tasks at the
+// back, idle workers steal from the front of another thread's deque, which holds the oldest (usually largest) tasks
+// workers with nothing to steal sleep until the next push, so an idle pool costs no cpu and no deque locks
+class work_stealing_pool {
+public:
+	// gets the index of the thread running it
+	using task = std::function<void(int thread)>;
+
+private:
+	struct entry {
+		const void *group; // lets a thread wait on its own tasks without running anyone else's
+		task work;
+	};
+
+	struct thread_queue {
+		std::mutex mutex;
+		std::deque<entry> tasks;
+	};
+
+	std::vector<thread_queue> queues; // one per thread, declared before workers so it outlives them
+
+	std::atomic<int> queued{0}; // tasks in every deque, workers only look through the deques while it isn't 0
+	std::atomic<int> sleeping{0}; // workers waiting on idle, so push only takes idle_mutex when there are some
+	std::mutex idle_mutex;
+	std::condition_variable_any idle;
+
+	std::vector<std::jthread> workers; // last, so they are joined before anything they use goes away
+
+	void worker_loop(std::stop_token stop, int thread);
+
+public:
+	// starts worker_count workers, numbered 1 to worker_count
+	explicit work_stealing_pool(int worker_count);
+
+	work_stealing_pool(const work_stealing_pool &) = delete;
+	work_stealing_pool &operator=(const work_stealing_pool &) = delete;
+
+	// the workers plus the owning thread
+	[[nodiscard]] int thread_count() const { return static_cast<int>(queues.size()); }
+
+	void push(int thread, const void *group, task work);
+	// takes the newest task on thread's own deque if it belongs to group
+	[[nodiscard]] bool pop(int thread, const void *group, task &work);
+	// takes the oldest task from any other thread's deque
+	[[nodiscard]] bool steal(int thief, task &work);
+};
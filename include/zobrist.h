@@ -0,0 +1,40 @@
+#pragma once
+
+#include "types.h"
+
+// castling rights bits, the index into zobrist_keys::castling
+constexpr uint8_t WHITE_KINGSIDE{1 << 0};
+constexpr uint8_t WHITE_QUEENSIDE{1 << 1};
+constexpr uint8_t BLACK_KINGSIDE{1 << 2};
+constexpr uint8_t BLACK_QUEENSIDE{1 << 3};
+
+// random keys for Zobrist hashing, made at compile time so every game (and every run) agrees on them
+struct zobrist_keys {
+	std::array<std::array<std::array<uint64_t, 64>, 6>, 2> pieces{}; // indexed by piece_color, piece_type then square
+	uint64_t black_to_move{};
+	std::array<uint64_t, 16> castling{}; // indexed by the castling rights bits
+	std::array<uint64_t, 8> en_passant_file{}; // indexed by square % 8
+
+	constexpr zobrist_keys() {
+		// splitmix64 with a fixed seed
+		uint64_t state{0x9E3779B97F4A7C15ULL};
+		auto next = [&state] {
+			state += 0x9E3779B97F4A7C15ULL;
+			uint64_t z{state};
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+			return z ^ (z >> 31);
+		};
+
+		for (auto &color: pieces) {
+			for (auto &type: color) {
+				for (auto &key: type) { key = next(); }
+			}
+		}
+		black_to_move = next();
+		for (auto &key: castling) { key = next(); }
+		for (auto &key: en_passant_file) { key = next(); }
+	}
+};
+
+inline constexpr zobrist_keys zobrist{};
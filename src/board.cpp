@@ -0,0 +1,329 @@
+#include "../include/board.h"
+#include "../include/setwise.h"
+
+#include <bit>
+#include <cctype>
+#include <cstdlib>
+
+namespace {
+	constexpr char piece_chars[] = {'P', 'B', 'N', 'R', 'Q', 'K'};
+
+	// same values as piece_data
+	constexpr std::array piece_values{100, 310, 300, 500, 900, 2000};
+}
+
+void board::put_piece(const int pos, const piece_type type, const piece_color color) {
+	const sb position{sb{1} << pos};
+	pieces[static_cast<int>(type)] |= position;
+	colors[static_cast<int>(color)] |= position;
+
+	const int code{1 + static_cast<int>(type) + 6 * static_cast<int>(color)};
+	const int shift{(pos & 1) * 4};
+	mailbox[pos >> 1] = static_cast<uint8_t>((mailbox[pos >> 1] & (0xF0 >> shift)) | (code << shift));
+}
+
+void board::remove_piece(const int pos) {
+	const sb position{sb{1} << pos};
+	const piece_type type{get_type(pos)};
+	if (type == piece_type::EMPTY) { return; }
+
+	pieces[static_cast<int>(type)] &= ~position;
+	colors[static_cast<int>(get_color(pos))] &= ~position;
+	mailbox[pos >> 1] &= static_cast<uint8_t>(0xF0 >> ((pos & 1) * 4));
+}
+
+std::string board::get() const {
+	std::string output;
+
+	int counter{0};
+
+	for (int i{63}; i >= 0; i--) {
+		if (i % 8 == 7 && i != 63) {
+			if (counter != 0) {
+				output += std::to_string(counter);
+				counter = 0;
+			}
+
+			output += '/';
+		}
+
+		const piece_type type{get_type(i)};
+		if (type == piece_type::EMPTY) {
+			counter++;
+			continue;
+		}
+
+		if (counter != 0) {
+			output += std::to_string(counter);
+			counter = 0;
+		}
+
+		const char c{piece_chars[static_cast<int>(type)]};
+		output += get_color(i) == piece_color::BLACK ? static_cast<char>(std::tolower(c)) : c;
+	}
+
+	if (counter != 0) { output += std::to_string(counter); }
+
+	return output;
+}
+
+void board::set(const std::string &fen) {
+	pieces = {};
+	colors = {};
+	mailbox = {};
+	state = WHITE_TO_MOVE;
+
+	// placement
+	size_t idx{0};
+	int pos{63};
+	for (; idx < fen.size() && fen[idx] != ' '; idx++) {
+		const char c{fen[idx]};
+
+		// skip over formatting
+		if (c == '/') { continue; }
+
+		// go through empty positons
+		if (std::isdigit(c)) {
+			pos -= c - '0';
+			continue;
+		}
+
+		for (int type{0}; type < 6; type++) {
+			if (piece_chars[type] != std::toupper(c)) { continue; }
+			put_piece(pos, static_cast<piece_type>(type), std::isupper(c) ? piece_color::WHITE : piece_color::BLACK);
+			break;
+		}
+
+		pos--;
+	}
+
+	// side to move
+	if (idx + 1 < fen.size() && fen[idx + 1] == 'b') { state &= ~WHITE_TO_MOVE; }
+	idx += 3;
+
+	// castling
+	if (idx < fen.size()) {
+		for (; idx < fen.size() && fen[idx] != ' '; idx++) {
+			switch (fen[idx]) {
+				case 'K': state |= WHITE_KINGSIDE;
+					break;
+				case 'Q': state |= WHITE_QUEENSIDE;
+					break;
+				case 'k': state |= BLACK_KINGSIDE;
+					break;
+				case 'q': state |= BLACK_QUEENSIDE;
+					break;
+				default: break;
+			}
+		}
+
+		// en passant target square, stored as the square of the pawn behind it
+		if (idx + 2 < fen.size() && fen[idx + 1] != '-') {
+			const int file{7 - (fen[idx + 1] - 'a')};
+			const int rank{fen[idx + 2] - '1'};
+			const int pawn_pos{(rank == 2 ? 3 : 4) * 8 + file};
+			state |= EN_PASSANT_VALID | pawn_pos << EN_PASSANT_SHIFT;
+		}
+	} else {
+		// no castling field, so any king and rook on their starting squares keep their rights
+		const sb white_rooks{get_pieces(piece_type::ROOK, piece_color::WHITE)};
+		const sb black_rooks{get_pieces(piece_type::ROOK, piece_color::BLACK)};
+		if (get_pieces(piece_type::KING, piece_color::WHITE) & 0x08ULL) {
+			if (white_rooks & 0x01ULL) { state |= WHITE_KINGSIDE; }
+			if (white_rooks & 0x80ULL) { state |= WHITE_QUEENSIDE; }
+		}
+		if (get_pieces(piece_type::KING, piece_color::BLACK) & 0x0800000000000000ULL) {
+			if (black_rooks & 0x0100000000000000ULL) { state |= BLACK_KINGSIDE; }
+			if (black_rooks & 0x8000000000000000ULL) { state |= BLACK_QUEENSIDE; }
+		}
+	}
+}
+
+sb board::side_attacks(const piece_color color) const {
+	std::array<sb, 6> side_pieces{};
+	for (int type{0}; type < 6; type++) { side_pieces[type] = pieces[type] & colors[static_cast<int>(color)]; }
+
+	const piece_color enemy{color == piece_color::WHITE ? piece_color::BLACK : piece_color::WHITE};
+	return side_attacks_setwise(side_pieces, color, colors[0] | colors[1], get_pieces(piece_type::KING, enemy));
+}
+
+sb board::pin_mask(const int pos, const piece_color color, const lookup_tables &lookup_table,
+                   const between_tables &between_table) const {
+	const sb king{get_pieces(piece_type::KING, color)};
+	if (king == 0) { return ~sb{0}; }
+
+	const int king_pos{__builtin_ctzll(king)};
+	const piece_color enemy{color == piece_color::WHITE ? piece_color::BLACK : piece_color::WHITE};
+	const sb enemy_board{colors[static_cast<int>(enemy)]};
+	const sb occupied{colors[0] | colors[1]};
+	const sb queens{pieces[static_cast<int>(piece_type::QUEEN)]};
+	const sb rooks{pieces[static_cast<int>(piece_type::ROOK)] | queens};
+	const sb bishops{pieces[static_cast<int>(piece_type::BISHOP)] | queens};
+
+	// enemy sliders that would hit the king if only enemy pieces were on the board
+	sb snipers{
+		(lookup_table.slider_table.rook_attacks(king_pos, enemy_board) & rooks)
+		| (lookup_table.slider_table.bishop_attacks(king_pos, enemy_board) & bishops)
+	};
+	snipers &= enemy_board;
+
+	while (snipers) {
+		const int sniper_pos{__builtin_ctzll(snipers)};
+		snipers &= snipers - 1;
+
+		// pinned if this piece is the only thing between the king and the sniper
+		const sb line{between_table[king_pos][sniper_pos]};
+		if (line & sb{1} << pos && std::popcount(line & occupied) == 3) { return line; }
+	}
+
+	return ~sb{0};
+}
+
+float board::evaluate_position() const {
+	// calculate material diff
+	int material_diff = 0;
+	for (int type{0}; type < 6; type++) {
+		const int white_count{std::popcount(get_pieces(static_cast<piece_type>(type), piece_color::WHITE))};
+		const int black_count{std::popcount(get_pieces(static_cast<piece_type>(type), piece_color::BLACK))};
+		material_diff += piece_values[type] * (white_count - black_count);
+	}
+
+	// calculate mobility diff (rough count of the number of moves each side can make)
+	int mobility_diff = std::popcount(side_attacks(piece_color::WHITE));
+	mobility_diff -= std::popcount(side_attacks(piece_color::BLACK));
+
+	// same weights as game_data (the king safety terms aren't weighted there yet, so they are left out)
+	constexpr float material_weight = 0.75f;
+	constexpr float mobility_weight = 0.02f;
+	return material_weight * static_cast<float>(material_diff) + mobility_weight *
+	       static_cast<float>(mobility_diff);
+}
+
+sb board::get_valid_moves(const int pos, const lookup_tables &lookup_table,
+                          const between_tables &between_table) const {
+	const piece_type type{get_type(pos)};
+	const piece_color color{get_color(pos)};
+	if (type == piece_type::EMPTY) { return 0; }
+
+	const piece_color enemy{color == piece_color::WHITE ? piece_color::BLACK : piece_color::WHITE};
+	const sb position{sb{1} << pos};
+	const sb friendly_board{colors[static_cast<int>(color)]};
+	const sb enemy_board{colors[static_cast<int>(enemy)]};
+	const sb occupied{friendly_board | enemy_board};
+
+	sb output{0};
+
+	switch (type) {
+		case piece_type::PAWN: {
+			const bool is_white{color == piece_color::WHITE};
+			const sb forward{is_white ? position << 8 : position >> 8};
+
+			// captures, plus en passant onto the square behind a pawn that just double moved
+			sb targets{enemy_board};
+			if (state & EN_PASSANT_VALID) {
+				const sb en_passant{sb{1} << (state >> EN_PASSANT_SHIFT & 0x3F)};
+				if (en_passant & enemy_board) { targets |= is_white ? en_passant << 8 : en_passant >> 8; }
+			}
+			output |= pawn_attacks(position, color) & targets;
+
+			// pushes
+			if (!(forward & occupied)) {
+				output |= forward;
+
+				const sb double_forward{is_white ? forward << 8 : forward >> 8};
+				const sb start_rank{is_white ? 0x000000000000FF00ULL : 0x00FF000000000000ULL};
+				if (position & start_rank && !(double_forward & occupied)) { output |= double_forward; }
+			}
+			break;
+		}
+		case piece_type::KNIGHT: {
+			output = lookup_table.knight_table[pos][0] & ~friendly_board;
+			break;
+		}
+		case piece_type::BISHOP: {
+			output = lookup_table.slider_table.bishop_attacks(pos, occupied) & ~friendly_board;
+			break;
+		}
+		case piece_type::ROOK: {
+			output = lookup_table.slider_table.rook_attacks(pos, occupied) & ~friendly_board;
+			break;
+		}
+		case piece_type::QUEEN: {
+			output = lookup_table.slider_table.queen_attacks(pos, occupied) & ~friendly_board;
+			break;
+		}
+		case piece_type::KING: {
+			const sb attacked{side_attacks(enemy)};
+			output = lookup_table.king_table[pos][0] & ~friendly_board & ~attacked;
+
+			// castling, with the same masks as game_data::king_logic
+			const uint16_t kingside{color == piece_color::WHITE ? WHITE_KINGSIDE : BLACK_KINGSIDE};
+			const uint16_t queenside{color == piece_color::WHITE ? WHITE_QUEENSIDE : BLACK_QUEENSIDE};
+			const sb rooks{get_pieces(piece_type::ROOK, color)};
+			if (!(attacked & position)) {
+				const int shift{56 * static_cast<int>(color)};
+				const sb queenside_path_mask{0x3000000000000000ULL >> shift};
+				const sb queenside_occupancy_mask{0x7000000000000000ULL >> shift};
+				const sb kingside_mask{0x0600000000000000ULL >> shift};
+
+				if (state & queenside && rooks & position << 4 && !(queenside_occupancy_mask & occupied)
+				    && !(queenside_path_mask & attacked)) { output |= position << 2; }
+				if (state & kingside && rooks & position >> 3 && !(kingside_mask & (occupied | attacked))) {
+					output |= position >> 2;
+				}
+			}
+			break;
+		}
+		default: break;
+	}
+
+	if (type != piece_type::KING) { output &= pin_mask(pos, color, lookup_table, between_table); }
+
+	return output;
+}
+
+void board::move(const int old_idx, const int new_idx, const lookup_tables &lookup_table) {
+	const piece_type type{get_type(old_idx)};
+	const piece_color color{get_color(old_idx)};
+
+	// en passant captures the pawn that just double moved, not the (empty) target square
+	if (type == piece_type::PAWN && get_type(new_idx) == piece_type::EMPTY && (new_idx - old_idx) % 8 != 0) {
+		remove_piece(state >> EN_PASSANT_SHIFT & 0x3F);
+	}
+
+	remove_piece(new_idx);
+	remove_piece(old_idx);
+	put_piece(new_idx, type, color);
+
+	// castling moves the rook over the king
+	if (type == piece_type::KING && !(lookup_table.king_table[old_idx][0] & sb{1} << new_idx)) {
+		const int rook_old_idx{new_idx > old_idx ? old_idx + 4 : old_idx - 3};
+		const int rook_new_idx{new_idx > old_idx ? new_idx - 1 : new_idx + 1};
+		remove_piece(rook_old_idx);
+		put_piece(rook_new_idx, piece_type::ROOK, color);
+	}
+
+	// castling rights are lost when the king moves or a rook leaves (or is taken on) its corner
+	uint16_t rights_lost{0};
+	if (type == piece_type::KING) {
+		rights_lost |= color == piece_color::WHITE
+			               ? WHITE_KINGSIDE | WHITE_QUEENSIDE
+			               : BLACK_KINGSIDE | BLACK_QUEENSIDE;
+	}
+	for (const int idx: {old_idx, new_idx}) {
+		if (idx == 0) { rights_lost |= WHITE_KINGSIDE; }
+		if (idx == 7) { rights_lost |= WHITE_QUEENSIDE; }
+		if (idx == 56) { rights_lost |= BLACK_KINGSIDE; }
+		if (idx == 63) { rights_lost |= BLACK_QUEENSIDE; }
+	}
+	state &= ~rights_lost;
+
+	// en passant updates
+	state &= ~(EN_PASSANT_VALID | 0x3F << EN_PASSANT_SHIFT);
+	if (type == piece_type::PAWN && std::abs(new_idx - old_idx) == 16) {
+		state |= EN_PASSANT_VALID | new_idx << EN_PASSANT_SHIFT;
+	}
+
+	// the side to move is always the side that didn't just move
+	if (color == piece_color::WHITE) { state &= ~WHITE_TO_MOVE; } else { state |= WHITE_TO_MOVE; }
+}
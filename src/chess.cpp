@@ -1,10 +1,40 @@
 #include "../include/chess.h"
+#include "../include/movegen.h"
 
+#include <algorithm>
 #include <bitset>
+#include <climits>
+#include <cstdlib>
 #include <iostream>
+#include <future>
 #include <random>
+#include <thread>
 
-chess::chess(const std::string &fen): gd(fen, tables.lookup_table, tables.between_table) {
+namespace {
+	// move_picker::next, timed as move generation
+	chess_move next_move(move_picker &picker, search_stats &stats) {
+		const stats_timer timer{stats.movegen_time};
+		return picker.next();
+	}
+
+	// for moves from the transposition table, which may come from a key collision
+	bool is_legal(game_data &gd, const chess_move move, const lookup_tables &lookup_table,
+	              const between_tables &between_table) {
+		move_list moves;
+		generate_legal_moves(gd, moves, lookup_table, between_table);
+		return std::ranges::find(moves, move) != moves.end();
+	}
+
+	bool is_checkmate(game_data &gd, const piece_color color, const lookup_tables &lookup_table,
+	                  const between_tables &between_table) {
+		if (!gd.in_check(color)) { return false; }
+		move_list moves;
+		generate_legal_moves(gd, moves, lookup_table, between_table);
+		return moves.size == 0;
+	}
+}
+
+chess::chess(const std::string &fen): gd(fen, tables->lookup_table) {
 	// randomly assign colors
 	std::mt19937 rng(std::random_device{}());
 	std::uniform_int_distribution dist(0, 1);
@@ -14,140 +44,740 @@ chess::chess(const std::string &fen): gd(fen, tables.lookup_table, tables.betwee
 	p2_color = static_cast<piece_color>(1 - color);
 }
 
-int chess::negamax(game_data pseudo_gd, const piece_color color, const int depth, int alpha, const int beta) {
-	if (depth == 0) {
-		return (color == piece_color::WHITE ? 1 : -1) * pseudo_gd.evaluate_position(
-			       tables.lookup_table, tables.between_table);
+void chess::check_limits(search_context &context) {
+	if (limit_reached(context, (context.nodes & 1023) == 0)) { context.stopped = true; }
+	// a brother at any split above this search failing high makes the rest of it pointless
+	for (const split_point *split{context.split}; split; split = split->parent->split) {
+		if (split->cutoff.load(std::memory_order_relaxed)) { context.stopped = true; }
 	}
+}
 
-	int max = INT_MIN;
-	sb own_board = color == piece_color::WHITE ? pseudo_gd.white_board : pseudo_gd.black_board;
+bool chess::limit_reached(search_context &context, const bool check_clock) {
+	if (context.abort && context.abort->load(std::memory_order_relaxed)) { return true; }
+	if (context.stop.stop_requested()) { return true; }
+	if (context.limits.nodes) {
+		// ybwc threads add their nodes to one total every 256, so the limit covers every thread's
+		uint64_t nodes{context.nodes};
+		if (context.shared_nodes) {
+			if ((context.nodes & 255) == 0) { report_nodes(context); }
+			nodes = context.shared_nodes->load(std::memory_order_relaxed) + context.nodes - context.reported_nodes;
+		}
+		if (nodes >= context.limits.nodes) { return true; }
+	}
+
+	if (context.limits.hard_time_ms && check_clock) {
+		const auto elapsed{std::chrono::steady_clock::now() - context.start};
+		if (elapsed >= std::chrono::milliseconds(context.limits.hard_time_ms)) { return true; }
+	}
+	return false;
+}
+
+int chess::score_to_table(const int score, const int ply) {
+	if (score > MATE_SCORE / 2) { return score + ply; }
+	if (score < -MATE_SCORE / 2) { return score - ply; }
+	return score;
+}
+
+int chess::score_from_table(const int score, const int ply) {
+	if (score > MATE_SCORE / 2) { return score - ply; }
+	if (score < -MATE_SCORE / 2) { return score + ply; }
+	return score;
+}
+
+void chess::report_nodes(search_context &context) {
+	context.shared_nodes->fetch_add(context.nodes - context.reported_nodes, std::memory_order_relaxed);
+	context.reported_nodes = context.nodes;
+}
 
+float chess::evaluate(search_context &context, const piece_color color) const {
+	const stats_timer timer{context.stats.eval_time};
+	return (color == piece_color::WHITE ? 1 : -1) * context.board.evaluate_position(tables->lookup_table);
+}
+
+int chess::negamax(search_context &context, const piece_color color, const int depth, const int ply, int alpha,
+                   const int beta, const bool null_move_allowed) {
+	// every way out of the node below leaves no line, until a move raises alpha
+	context.pv.length[ply] = 0;
+	if (depth <= 0) { return quiescence(context, color, ply, alpha, beta); }
+
+	context.nodes++;
+	if constexpr (SEARCH_STATS_ENABLED) { context.stats.seldepth = std::max(context.stats.seldepth, ply); }
+	check_limits(context);
+	if (context.stopped) { return 0; }
+
+	game_data &pseudo_gd{context.board};
+
+	// a draw whatever comes next (not at the root, which has to come back with a move), except that a mate on the
+	// move that reaches fifty still counts
+	if (ply > 0 && pseudo_gd.is_repetition()) { return 0; }
+	if (ply > 0 && pseudo_gd.fifty_moves()
+	    && !is_checkmate(pseudo_gd, color, tables->lookup_table, tables->between_table)) { return 0; }
+
+	// a result from a search at least this deep can be used straight away, otherwise its move is tried first
+	// (not at the root, which has to come back with a move)
+	const uint64_t key{pseudo_gd.hash()};
+	chess_move hash_move{};
+	if constexpr (SEARCH_STATS_ENABLED) { context.stats.tt_probes++; }
+	if (tt_entry entry{}; tt.probe(key, entry)) {
+		if constexpr (SEARCH_STATS_ENABLED) { context.stats.tt_hits++; }
+		hash_move = entry.best_move;
+		const int score{score_from_table(entry.score, ply)};
+		if (entry.depth >= depth && ply > 0 && (entry.bound == bound_type::EXACT
+		                                        || (entry.bound == bound_type::LOWER && score >= beta)
+		                                        || (entry.bound == bound_type::UPPER && score <= alpha))) {
+			if constexpr (SEARCH_STATS_ENABLED) { context.stats.tt_cutoffs++; }
+			return score;
+		}
+	}
+	if (hash_move.is_null()) { hash_move = seed_move(context, ply); }
+
+	const bool in_check{pseudo_gd.in_check(color)};
 	const auto opponent_color = color == piece_color::WHITE ? piece_color::BLACK : piece_color::WHITE;
 
-	while (own_board) {
-		const int piece_index = __builtin_ctzll(own_board);
-		sb valid_moves = pseudo_gd.get_valid_moves(piece_index, tables.lookup_table, tables.between_table);
+	// null move pruning: if passing the turn still fails high in a shallower search, a real move would too
+	// not in check (passing would be illegal), not twice in a row, not near a mate score, and not with only pawns
+	// left, where being made to move can be what loses (zugzwang)
+	if (null_move_allowed && ply > 0 && depth >= NULL_MOVE_MIN_DEPTH && !in_check && std::abs(beta) < MATE_SCORE / 2
+	    && pseudo_gd.has_non_pawn_material(color) && evaluate(context, color) >= beta) {
+		// deeper searches can afford to skip more
+		const int reduction{depth >= 7 ? 3 : 2};
+
+		{
+			const stats_timer timer{context.stats.move_time};
+			pseudo_gd.make_null_move(context.stack);
+		}
+		const int result = -negamax(context, opponent_color, depth - 1 - reduction, ply + 1, -beta, -beta + 1, false);
+		{
+			const stats_timer timer{context.stats.move_time};
+			pseudo_gd.unmake_null_move(context.stack);
+		}
 
-		while (valid_moves) {
-			const int move_index = __builtin_ctzll(valid_moves);
-			// make sure the move is valid
-			if (check_move(piece_index, move_index, pseudo_gd)) {
-				game_data new_pseudo_gd = pseudo_gd;
-				new_pseudo_gd.move(piece_index, move_index, tables.lookup_table, tables.between_table);
+		if (context.stopped) { return 0; }
+		if (result >= beta) { return beta; }
+	}
 
-				// check if the new move is good
-				const int result = -negamax(new_pseudo_gd, opponent_color, depth - 1, -beta, -alpha);
-				max = std::max(max, result);
-				alpha = std::max(alpha, max);
+	// captures come out before quiet moves, which are only generated if no capture cuts off
+	move_picker picker{
+		[&] {
+			const stats_timer timer{context.stats.movegen_time};
+			return move_picker(pseudo_gd, hash_move, tables->lookup_table, tables->between_table, false,
+			                   &context.history, ply);
+		}()
+	};
 
-				if (alpha >= beta) { return max; }
+	const int original_alpha{alpha};
+	int max = INT_MIN;
+	chess_move best_move{};
+	int legal_moves{0};
+
+	for (chess_move move{next_move(picker, context.stats)}; !move.is_null(); move = next_move(picker, context.stats)) {
+		if (ply == 0 && is_excluded(context, move)) { continue; }
+
+		legal_moves++;
+		const int result{search_move(context, color, move, legal_moves, depth, ply, alpha, beta, in_check)};
+		if (context.stopped) { return 0; }
+
+		// at the root only a move that raised alpha is trusted, a fail low score is just a bound
+		if (ply == 0 && (legal_moves == 1 || result > alpha)) { context.root_move = move; }
+		if (result > alpha) { context.pv.update(ply, move); }
+		if (result > max) {
+			max = result;
+			best_move = move;
+		}
+		alpha = std::max(alpha, max);
+
+		if (alpha >= beta) {
+			if constexpr (SEARCH_STATS_ENABLED) {
+				context.stats.beta_cutoffs++;
+				if (legal_moves == 1) { context.stats.first_move_cutoffs++; }
 			}
+			// captures are already ordered by what they win, only quiet moves are worth remembering
+			if (!move.is_capture()) { context.history.record_cutoff(color, ply, move, depth); }
+			break;
+		}
+
+		// young brothers wait: once the eldest brother is searched without a cutoff, the rest go to the pool
+		if (context.pool && depth >= SPLIT_MIN_DEPTH) {
+			const split_result split{
+				split_search(context, picker, color, depth, ply, alpha, beta, in_check, legal_moves)
+			};
+			if (context.stopped) { return 0; }
 
-			valid_moves &= ~(sb{1} << move_index);
+			legal_moves += split.moves;
+			if (split.score > alpha) {
+				context.pv.update(ply, split.best_move, split.line.data(), static_cast<int>(split.line.size()));
+			}
+			if (split.score > max) {
+				max = split.score;
+				best_move = split.best_move;
+			}
+			if (max >= beta) {
+				if constexpr (SEARCH_STATS_ENABLED) { context.stats.beta_cutoffs++; }
+				if (!best_move.is_capture()) { context.history.record_cutoff(color, ply, best_move, depth); }
+			}
+			break;
 		}
+	}
 
-		own_board &= ~(sb{1} << piece_index);
+	// no moves is either mate (sooner is worse, so count the plies from the root) or stalemate
+	if (legal_moves == 0) { return in_check ? -MATE_SCORE + ply : 0; }
+	if constexpr (SEARCH_STATS_ENABLED) { context.stats.expanded_nodes++; }
+
+	const bound_type bound{
+		max >= beta ? bound_type::LOWER : max <= original_alpha ? bound_type::UPPER : bound_type::EXACT
+	};
+	// a fail low has no real best move, every move was only shown to be at most alpha
+	// (a root with moves left out for multi-pv isn't the real position's result)
+	if (ply > 0 || context.excluded_root_moves.size == 0) {
+		tt.store(key, depth, score_to_table(max, ply), bound, bound == bound_type::UPPER ? chess_move{} : best_move);
 	}
 
 	return max;
 }
 
-bool chess::check_move(const int old_idx, const int new_idx, game_data &search_gd) const {
-	piece_color piece_color = search_gd.get_color(sb{1} << old_idx);
-	const piece_data piece = piece_color == piece_color::WHITE
-		                         ? search_gd.white_pieces[gd.piece_lookup[old_idx]]
-		                         : search_gd.black_pieces[gd.piece_lookup[old_idx]];
-	auto [friendly_pieces, enemy_pieces] = search_gd.get_pieces(piece_color);
-
-	// get valid moves and check them against the new position
-	const sb valid_moves = search_gd.get_valid_moves(old_idx, tables.lookup_table, tables.between_table);
-	const bool is_move_valid = valid_moves & (sb{1} << new_idx);
-
-	// is the move is not valid, then can never be true
-	if (!is_move_valid) { return false; }
-
-	// king can always move to a valid space no matter how many checks (also non-check moves)
-	if (piece.type == piece_type::KING) { return true; }
-
-	// check if the king is under attack
-	if (search_gd.side_attacks[1 - static_cast<int>(piece_color)] & (*friendly_pieces)[15].position) {
-		// check if the king is in double check
-		int check_count{0};
-		const piece_data *attacker = nullptr;
-		for (auto &enemy_piece: *enemy_pieces) {
-			if (enemy_piece.attacks & (*friendly_pieces)[15].position) {
-				attacker = &enemy_piece;
-				check_count++;
-				if (check_count > 1) { break; }
+int chess::search_move(search_context &context, const piece_color color, const chess_move move, const int move_number,
+                       const int depth, const int ply, const int alpha, const int beta, const bool in_check) {
+	game_data &pseudo_gd{context.board};
+	const auto opponent_color = color == piece_color::WHITE ? piece_color::BLACK : piece_color::WHITE;
+
+	{
+		const stats_timer timer{context.stats.move_time};
+		pseudo_gd.make_move(move, context.stack, tables->lookup_table);
+	}
+	const bool follows_seed{move == seed_move(context, ply)};
+	if (follows_seed) { context.seed_ply++; }
+
+	// principal variation search: the first move is expected to be the best one, so the rest are only checked
+	// with a null window to show they are no better, and searched again in full if one turns out to be
+	int result;
+	if (move_number == 1) {
+		result = -negamax(context, opponent_color, depth - 1, ply + 1, -beta, -alpha);
+	} else {
+		// late move reductions: quiet moves this far down the ordering rarely matter, so they get a shallower
+		// null window search first and only the full depth if they beat alpha anyway
+		int reduction{0};
+		if (move_number > LMR_MIN_MOVES && depth >= LMR_MIN_DEPTH && !in_check && !move.is_capture()
+		    && !pseudo_gd.in_check(opponent_color) && move != context.history.killers[ply][0]
+		    && move != context.history.killers[ply][1]) {
+			reduction = std::min(move_number > 2 * LMR_MIN_MOVES ? 2 : 1, depth - 2);
+		}
+
+		result = -negamax(context, opponent_color, depth - 1 - reduction, ply + 1, -alpha - 1, -alpha);
+		if (result > alpha && reduction > 0 && !context.stopped) {
+			result = -negamax(context, opponent_color, depth - 1, ply + 1, -alpha - 1, -alpha);
+		}
+		if (result > alpha && result < beta && !context.stopped) {
+			result = -negamax(context, opponent_color, depth - 1, ply + 1, -beta, -alpha);
+		}
+	}
+	if (follows_seed) { context.seed_ply--; }
+	{
+		const stats_timer timer{context.stats.move_time};
+		pseudo_gd.unmake_move(move, context.stack);
+	}
+
+	return result;
+}
+
+chess::split_result chess::split_search(search_context &context, move_picker &picker, const piece_color color,
+                                        const int depth, const int ply, const int alpha, const int beta,
+                                        const bool in_check, const int moves_searched) {
+	move_list brothers;
+	for (chess_move move{next_move(picker, context.stats)}; !move.is_null(); move = next_move(picker, context.stats)) {
+		if (ply > 0 || !is_excluded(context, move)) { brothers.push(move); }
+	}
+	if (brothers.size == 0) { return {INT_MIN, chess_move{}, 0, {}}; }
+
+	split_point split{&context, color, depth, ply, beta, in_check, alpha, brothers.size};
+
+	// pushed worst first, so the owner pops the best brothers first and thieves take the worst
+	for (int i{brothers.size - 1}; i >= 0; i--) {
+		context.pool->push(context.thread, &split, [this, &split, move = brothers.moves[i],
+			                   move_number = moves_searched + i + 1](const int thread) {
+			                   run_brother(split, move, move_number, thread);
+		                   });
+	}
+
+	// the owner only helps with its own brothers while it waits, anything else could keep it away for too long
+	while (split.pending.load(std::memory_order_acquire) > 0) {
+		// a stop or a hard limit is passed on to every thread's brothers, those the owner can't see included
+		if (!context.stopped && limit_reached(context, true)) {
+			context.stopped = true;
+			context.abort->store(true, std::memory_order_relaxed);
+		}
+		if (work_stealing_pool::task work; context.pool->pop(context.thread, &split, work)) {
+			work(context.thread);
+		} else {
+			std::this_thread::yield();
+		}
+	}
+
+	// a brother that raised alpha at the root is worth keeping even if the search was cut off
+	if (ply == 0 && split.best_score > alpha) { context.root_move = split.best_move; }
+
+	check_limits(context);
+	if (split.stopped) { context.stopped = true; }
+
+	return {split.best_score, split.best_move, brothers.size, std::move(split.best_line)};
+}
+
+void chess::run_brother(split_point &split, const chess_move move, const int move_number, const int thread) {
+	const int alpha{split.alpha.load(std::memory_order_relaxed)};
+
+	if (!split.cutoff.load(std::memory_order_relaxed)) {
+		// every brother starts from the node's board and the owner's killers and history
+		const search_context &parent{*split.parent};
+		search_context brother{parent.board, parent.limits, parent.start, parent.stop};
+		brother.shared_nodes = parent.shared_nodes;
+		brother.history = parent.history;
+		brother.abort = parent.abort;
+		brother.pool = parent.pool;
+		brother.pool_stats = parent.pool_stats;
+		brother.split = &split;
+		brother.thread = thread;
+
+		const int result{
+			search_move(brother, split.color, move, move_number, split.depth, split.ply, alpha, split.beta,
+			            split.in_check)
+		};
+		if (brother.shared_nodes) { report_nodes(brother); }
+		// a brother failing high stops the rest, which is the point, anything else is a real stop
+		const bool cut_off{brother.stopped && split.cutoff.load(std::memory_order_relaxed)};
+		// only this thread writes its own slot
+		brother.stats.nodes = brother.nodes;
+		brother.stats.cut_brothers += cut_off;
+		brother.pool_stats[thread] += brother.stats;
+
+		if (brother.stopped) {
+			if (!cut_off) { split.stopped = true; }
+		} else {
+			const std::lock_guard lock{split.mutex};
+			if (result > split.best_score) {
+				split.best_score = result;
+				split.best_move = move;
+				const auto &line{brother.pv.moves[split.ply + 1]};
+				split.best_line.assign(line.begin(), line.begin() + brother.pv.length[split.ply + 1]);
 			}
+			if (result > split.alpha.load(std::memory_order_relaxed)) {
+				split.alpha.store(result, std::memory_order_relaxed);
+			}
+			if (result >= split.beta) { split.cutoff = true; }
 		}
+	}
 
-		// if there are more than two attackers, would've had to be the king
-		if (check_count > 1) { return false; }
+	// last, the owner may return (and free split) as soon as this reaches 0
+	split.pending.fetch_sub(1, std::memory_order_release);
+}
 
-		// if there is one check and king isn't moving, then must block or take
-		if (check_count == 1) {
-			const sb new_pos = sb{1} << new_idx;
+int chess::quiescence(search_context &context, const piece_color color, const int ply, int alpha, const int beta) {
+	context.nodes++;
+	if constexpr (SEARCH_STATS_ENABLED) {
+		context.stats.quiescence_nodes++;
+		context.stats.seldepth = std::max(context.stats.seldepth, ply);
+	}
+	check_limits(context);
+	if (context.stopped) { return 0; }
 
-			// checks for null attacker (edge case)
-			if (!attacker) { return false; }
+	game_data &pseudo_gd{context.board};
+	const bool in_check{pseudo_gd.in_check(color)};
 
-			// any move taking the attacker is valid
-			if (new_pos == attacker->position) { return true; }
+	// stand pat: the side to move can usually do at least as well as the static score by not capturing
+	// (not when in check, every evasion has to be looked at)
+	int max = INT_MIN;
+	int stand_pat{0};
+	if (!in_check) {
+		stand_pat = evaluate(context, color);
+		if (stand_pat >= beta) { return stand_pat; }
+		// even winning a queen wouldn't reach alpha
+		if (stand_pat + QUEEN_VALUE + DELTA_MARGIN < alpha) { return stand_pat; }
+
+		max = stand_pat;
+		alpha = std::max(alpha, stand_pat);
+	}
+
+	move_picker picker{
+		[&] {
+			const stats_timer timer{context.stats.movegen_time};
+			return move_picker(pseudo_gd, chess_move{}, tables->lookup_table, tables->between_table, !in_check);
+		}()
+	};
+
+	int legal_moves{0};
+
+	const auto opponent_color = color == piece_color::WHITE ? piece_color::BLACK : piece_color::WHITE;
 
-			// if the attacker isn't a slider, can only take it
-			if (!attacker->is_slider) { return false; }
+	for (chess_move move{next_move(picker, context.stats)}; !move.is_null(); move = next_move(picker, context.stats)) {
+		legal_moves++;
 
-			// the move must block the attacker
-			if (!(new_pos & tables.between_table[game_data::sb_to_int((*friendly_pieces)[15].position)][
-				      game_data::sb_to_int(attacker->position)])) { return false; }
+		// delta pruning, skip captures that can't bring the score up to alpha
+		if (!in_check) {
+			const int captured_value{
+				move.flag() == move_flag::EN_PASSANT ? PAWN_VALUE : pseudo_gd.get_piece(move.to())->value
+			};
+			if (stand_pat + captured_value + DELTA_MARGIN <= alpha) { continue; }
 		}
+
+		{
+			const stats_timer timer{context.stats.move_time};
+			pseudo_gd.make_move(move, context.stack, tables->lookup_table);
+		}
+		const int result = -quiescence(context, opponent_color, ply + 1, -beta, -alpha);
+		{
+			const stats_timer timer{context.stats.move_time};
+			pseudo_gd.unmake_move(move, context.stack);
+		}
+
+		if (context.stopped) { return 0; }
+
+		max = std::max(max, result);
+		alpha = std::max(alpha, max);
+
+		if (alpha >= beta) { break; }
 	}
 
-	return true;
+	// in check with no way out (the horizon is depth 0)
+	if (in_check && legal_moves == 0) { return -MATE_SCORE + ply; }
+
+	return max;
+}
+
+bool chess::check_move(const int old_idx, const int new_idx, game_data &search_gd) const {
+	const piece_color piece_color{search_gd.get_color(sb{1} << old_idx)};
+	if (piece_color == piece_color::NONE) { return false; }
+
+	// the same masks the move generator uses, a double check leaves non-king pieces with an empty evasion mask
+	const position_masks masks{search_gd.get_position_masks(piece_color, tables->lookup_table, tables->between_table)};
+	return search_gd.get_legal_moves(old_idx, masks, tables->lookup_table) & (sb{1} << new_idx);
+}
+
+move_list chess::get_legal_moves() {
+	move_list moves;
+	generate_legal_moves(gd, moves, tables->lookup_table, tables->between_table);
+	return moves;
 }
 
-void chess::ai_move(const int depth) {
-	game_data pseudo_gd = gd;
-	std::pair best_move{-1, -1};
+bool chess::is_excluded(const search_context &context, const chess_move move) {
+	return std::ranges::find(context.excluded_root_moves, move) != context.excluded_root_moves.end();
+}
+
+int chess::aspiration_search(search_context &context, const int depth, const int guess, chess_move &fail_high_move) {
+	// aspiration window: once the score has settled the next iteration is searched in a window around it, a
+	// score outside the window means searching again with that side widened
+	int delta{ASPIRATION_WINDOW};
+	int alpha{INT_MIN + 1};
+	int beta{INT_MAX};
+	if (depth >= ASPIRATION_DEPTH && std::abs(guess) < MATE_SCORE / 2) {
+		alpha = guess - delta;
+		beta = guess + delta;
+	}
 
-	int best_score = INT_MIN;
-	sb own_board = p2_color == piece_color::WHITE ? pseudo_gd.white_board : pseudo_gd.black_board;
+	while (true) {
+		context.root_move = chess_move{};
+		const int result{negamax(context, context.board.side_to_move, depth, 0, alpha, beta)};
+		if (context.stopped) { return 0; }
+
+		if (result <= alpha) {
+			alpha = std::max(result - delta, INT_MIN + 1);
+		} else if (result >= beta) {
+			beta = std::min(result + delta, INT_MAX);
+			// a fail high move is already better than anything else, keep it in case the search is cut off
+			fail_high_move = context.root_move;
+		} else {
+			return result;
+		}
+		delta *= 2;
+	}
+}
 
-	const auto opponent_color = p2_color == piece_color::WHITE ? piece_color::BLACK : piece_color::WHITE;
+std::vector<chess_move> chess::principal_variation(const search_context &context, const int max_length) const {
+	// a root move that never raised alpha (every move failed low) has no line of its own
+	const pv_table &pv{context.pv};
+	std::vector<chess_move> line{context.root_move};
+	if (pv.length[0] > 0 && pv.moves[0][0] == context.root_move) {
+		line.assign(pv.moves[0].begin(), pv.moves[0].begin() + std::min(pv.length[0], max_length));
+	}
 
-	while (own_board) {
-		const int piece_index = __builtin_ctzll(own_board);
-		sb valid_moves = pseudo_gd.get_valid_moves(piece_index, tables.lookup_table, tables.between_table);
+	game_data board{context.board};
+	undo_stack stack;
+	std::vector<uint64_t> seen{board.hash()};
+	for (const chess_move move: line) {
+		board.make_move(move, stack, tables->lookup_table);
+		seen.push_back(board.hash());
+	}
 
-		while (valid_moves) {
-			const int move_index = __builtin_ctzll(valid_moves);
-			// make sure the move is valid
-			if (check_move(piece_index, move_index, pseudo_gd)) {
-				game_data new_pseudo_gd = pseudo_gd;
-				new_pseudo_gd.move(piece_index, move_index, tables.lookup_table, tables.between_table);
+	// follow the table's best moves, stopping at a miss, an illegal move or a position already on the line
+	while (static_cast<int>(line.size()) < max_length) {
+		tt_entry entry{};
+		if (!tt.probe(board.hash(), entry) || entry.best_move.is_null()) { break; }
+		if (!is_legal(board, entry.best_move, tables->lookup_table, tables->between_table)) { break; }
 
-				// check if the new move is good
-				const int result = -negamax(new_pseudo_gd, opponent_color, depth - 1, INT_MIN + 1, INT_MAX);
+		line.push_back(entry.best_move);
+		board.make_move(entry.best_move, stack, tables->lookup_table);
+		if (std::ranges::find(seen, board.hash()) != seen.end()) { break; }
+		seen.push_back(board.hash());
+	}
 
-				if (result > best_score) {
-					best_move = std::make_pair(piece_index, move_index);
-					best_score = result;
+	return line;
+}
+
+chess_move chess::seed_move(const search_context &context, const int ply) {
+	if (ply != context.seed_ply || ply >= static_cast<int>(context.seed.size())) { return chess_move{}; }
+	return context.seed[ply];
+}
+
+void chess::remember_pv(const game_data &root, const search_result &result) {
+	last_pv.clear();
+	last_pv_keys.clear();
+	if (result.lines.empty()) { return; }
+
+	game_data board{root};
+	undo_stack stack;
+	for (const chess_move move: result.lines[0].moves) {
+		last_pv.push_back(move);
+		last_pv_keys.push_back(board.hash());
+		board.make_move(move, stack, tables->lookup_table);
+	}
+}
+
+search_result chess::iterative_deepening(search_context &context, const int max_depth, const int depth_offset) {
+	search_result result;
+
+	// each iteration stores its best move in the table, so the next one searches it first
+	for (int iteration{1}; iteration <= max_depth; iteration++) {
+		const int depth{std::min(iteration + depth_offset, max_depth)};
+
+		// multi-pv: each line searches the root again without the moves of the lines before it
+		std::vector<pv_line> lines;
+		context.excluded_root_moves.size = 0;
+		for (size_t line{0}; line < static_cast<size_t>(context.multi_pv); line++) {
+			// each line is guessed to score what the line in its place did last iteration
+			const int guess{line < result.lines.size() ? result.lines[line].score : result.score};
+			chess_move fail_high_move{};
+			const int score{aspiration_search(context, depth, guess, fail_high_move)};
+
+			// a cut off iteration still searched the previous best move first, so anything it found is better
+			if (context.stopped) {
+				if (line == 0 && !context.root_move.is_null()) {
+					result.best_move = context.root_move;
+				} else if (line == 0 && !fail_high_move.is_null()) {
+					result.best_move = fail_high_move;
 				}
+				break;
 			}
 
-			valid_moves &= ~(sb{1} << move_index);
+			// fewer root moves than lines
+			if (context.root_move.is_null()) { break; }
+
+			lines.push_back({score, principal_variation(context, depth)});
+			context.excluded_root_moves.push(context.root_move);
+		}
+		// later lines can come back higher than earlier ones when the search is unstable
+		std::ranges::stable_sort(lines, std::greater{}, &pv_line::score);
+
+		// the lines this iteration did finish are deeper than the last one's, which fill in the ranks it didn't reach
+		if (context.stopped) {
+			if (!lines.empty()) {
+				result.best_move = lines[0].moves[0];
+				result.score = lines[0].score;
+				for (pv_line &last: result.lines) {
+					if (lines.size() >= static_cast<size_t>(context.multi_pv)) { break; }
+					auto same_root = [&last](const pv_line &line) { return line.moves[0] == last.moves[0]; };
+					if (std::ranges::none_of(lines, same_root)) { lines.push_back(std::move(last)); }
+				}
+				result.lines = std::move(lines);
+			}
+			break;
 		}
 
-		own_board &= ~(sb{1} << piece_index);
+		if (!lines.empty()) {
+			result.best_move = lines[0].moves[0];
+			result.score = lines[0].score;
+		}
+		result.depth = depth;
+		result.lines = std::move(lines);
+
+		const auto elapsed{std::chrono::steady_clock::now() - context.start};
+		if (context.limits.soft_time_ms && elapsed >= std::chrono::milliseconds(context.limits.soft_time_ms)) { break; }
+		if (depth == max_depth) { break; }
 	}
 
+	return result;
+}
+
+void chess::prepare_table() {
+	if (tt.empty()) { tt.resize(DEFAULT_HASH_MB); }
+	tt.new_search();
+}
+
+search_result chess::search(const game_data &root, const search_limits &limits, const std::stop_token &stop) {
+	const auto start{std::chrono::steady_clock::now()};
+	const int max_depth{limits.depth > 0 ? std::min(limits.depth, MAX_DEPTH) : MAX_DEPTH};
+
+	// the search moves this one board in place, taking each move back off the undo stack
+	search_context context{root, limits, start, stop};
+	context.multi_pv = multi_pv_lines;
+
+	// the last search's line still holds from wherever this root is on it (the same position, or a couple of moves
+	// later if the game followed it), the table may have lost some of it since
+	const auto on_line{std::ranges::find(last_pv_keys, root.hash())};
+	if (on_line != last_pv_keys.end()) {
+		context.seed.assign(last_pv.begin() + (on_line - last_pv_keys.begin()), last_pv.end());
+	}
+
+	std::vector<search_context> helper_contexts;
+	std::vector<search_stats> pool_stats(thread_count); // what each pool thread searched for split nodes
+	search_result result;
+
+	if (parallelism == parallel_mode::YBWC && thread_count > 1) {
+		// the main thread searches as usual, splitting nodes for the pool's workers as it goes
+		work_stealing_pool pool{thread_count - 1};
+		std::atomic<uint64_t> pool_nodes{0};
+		std::atomic<bool> stop_brothers{false};
+		context.abort = &stop_brothers;
+		context.pool = &pool;
+		context.pool_stats = pool_stats.data();
+		context.shared_nodes = &pool_nodes;
+		result = iterative_deepening(context, max_depth, 0);
+	} else {
+		// lazy smp: helpers search the same root on their own board and history, sharing only the transposition
+		// table; every other helper runs one ply ahead, so the threads spread out over the tree and fill the table
+		// with results the main thread can use, only the main thread's move is played
+		std::atomic<bool> stop_helpers{false};
+		helper_contexts.reserve(thread_count - 1);
+		for (int i{1}; i < thread_count; i++) {
+			search_context &helper{helper_contexts.emplace_back(context.board, search_limits{}, start, stop)};
+			helper.abort = &stop_helpers;
+		}
+
+		std::vector<std::jthread> helpers;
+		helpers.reserve(helper_contexts.size());
+		for (size_t i{0}; i < helper_contexts.size(); i++) {
+			helpers.emplace_back([this, &helper_contexts, i, max_depth] {
+				(void) iterative_deepening(helper_contexts[i], max_depth, static_cast<int>((i + 1) % 2));
+			});
+		}
+
+		result = iterative_deepening(context, max_depth, 0);
+
+		stop_helpers = true;
+		helpers.clear(); // joins
+	}
+
+	const double seconds{std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
+	auto per_second = [seconds](const uint64_t nodes) { return seconds > 0 ? nodes / seconds : 0; };
+
+	// every thread's counters go into one total, the helpers' own searches as well as any split nodes
+	context.stats.nodes = context.nodes;
+	for (search_context &helper: helper_contexts) { helper.stats.nodes = helper.nodes; }
+
+	for (int i{0}; i < thread_count; i++) {
+		search_stats thread{pool_stats[i]};
+		if (i == 0) {
+			thread += context.stats;
+		} else if (!helper_contexts.empty()) {
+			thread += helper_contexts[i - 1].stats;
+		}
+		result.stats += thread;
+		result.threads.push_back({thread.nodes, per_second(thread.nodes), pool_stats[i].nodes});
+	}
+	result.stats.depth = result.depth;
+	result.stats.nodes_per_second = per_second(result.stats.nodes);
+
+	// cut off before depth 1 finished, any legal move beats none
+	if (result.best_move.is_null()) {
+		move_list moves;
+		generate_legal_moves(context.board, moves, tables->lookup_table, tables->between_table);
+		if (moves.size > 0) { result.best_move = moves.moves[0]; }
+	}
+
+	return result;
+}
+
+chess_move chess::ai_move(const search_limits &limits) {
+	prepare_table();
+
+	// the ai always plays p2, whoever moved last
+	game_data root{gd};
+	root.set_side_to_move(p2_color);
+	const search_result result{search(root, limits, {})};
+	last_stats = result.stats;
+	thread_report = result.threads;
+	remember_pv(root, result);
+	const chess_move best_move{result.best_move};
+
 	// make the best move
-	if (best_move.first == -1 || best_move.second == -1) {
+	if (best_move.is_null()) {
 		std::cerr << "AI ERROR: NO BEST MOVE FOUND" << std::endl;
-		return;
+		return best_move;
+	}
+
+	move(best_move.from(), best_move.to());
+	return best_move;
+}
+
+search_result chess::analyze(const search_limits &limits) {
+	prepare_table();
+
+	// searched on a copy, gd is left as it is
+	search_result result{search(gd, limits, {})};
+	thread_report = result.threads;
+	remember_pv(gd, result);
+	return result;
+}
+
+search_handle chess::search_async(const search_limits &limits, const std::stop_token &stop) {
+	prepare_table();
+
+	game_data root{gd};
+	root.set_side_to_move(p2_color);
+	return start_search(std::move(root), limits, stop);
+}
+
+search_handle chess::start_search(game_data root, const search_limits &limits, const std::stop_token &stop) {
+	// the board is copied here, so the caller may move on gd while the search runs
+	std::promise<search_result> promise;
+	std::future<search_result> future{promise.get_future()};
+
+	std::jthread worker{
+		[this, root = std::move(root), limits, stop, promise = std::move(promise)](const std::stop_token own) mutable {
+			// either the handle or the caller's token can stop the search
+			std::stop_source source;
+			std::stop_callback from_handle{own, [&source] { source.request_stop(); }};
+			std::stop_callback from_caller{stop, [&source] { source.request_stop(); }};
+			promise.set_value(search(root, limits, source.get_token()));
+		}
+	};
+
+	return {std::move(future), std::move(worker)};
+}
+
+chess_move chess::expected_reply() const {
+	if (tt.empty()) { return chess_move{}; }
+
+	// after ai_move the opponent is to move in gd, the move the table has for that position is the one the search
+	// expected
+	game_data position{gd};
+	position.set_side_to_move(p1_color);
+
+	tt_entry entry{};
+	if (!tt.probe(position.hash(), entry) || entry.best_move.is_null()) { return chess_move{}; }
+
+	// the table can collide, only hand out a move that is legal here
+	return is_legal(position, entry.best_move, tables->lookup_table, tables->between_table) ? entry.best_move
+		       : chess_move{};
+}
+
+search_handle chess::ponder(const chess_move reply) {
+	prepare_table();
+
+	// the position the ai expects to face next, the move makes it p2's turn
+	game_data root{gd};
+	root.set_side_to_move(p1_color);
+	// a reply from an older position or a table collision is searched as if there were none
+	if (!reply.is_null() && is_legal(root, reply, tables->lookup_table, tables->between_table)) {
+		undo_stack stack;
+		root.make_move(reply, stack, tables->lookup_table);
 	}
 
-	move(best_move.first, best_move.second);
+	return start_search(std::move(root), search_limits{}, {});
 }
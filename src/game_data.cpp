@@ -1,8 +1,12 @@
 #include "../include/game_data.h"
+#include "../include/setwise.h"
 
+#include <algorithm>
+#include <bit>
 #include <bitset>
 #include <iostream>
-#include <span>
+#include <sstream>
+#include <tuple>
 #include <unordered_map>
 
 std::string game_data::get() const {
@@ -52,13 +56,28 @@ std::string game_data::get() const {
 	return output;
 }
 
-void game_data::set(const std::string &fen, const lookup_tables &lookup_table, const between_tables &between_table) {
+void game_data::set(const std::string &fen, const lookup_tables &lookup_table) {
 	// reset all old data
 	white_board = 0;
 	black_board = 0;
 	white_pieces = {};
 	black_pieces = {};
 	std::fill(piece_lookup.begin(), piece_lookup.end(), 255);
+	en_passant_board = 0;
+
+	// the side to move is the second field (white if it is missing)
+	const size_t side_field{fen.find(' ')};
+	side_to_move = side_field != std::string::npos && side_field + 1 < fen.size() && fen[side_field + 1] == 'b'
+		               ? piece_color::BLACK
+		               : piece_color::WHITE;
+
+	// the halfmove clock is the fifth field (0 if it is missing), castling and en passant come from the pieces
+	std::istringstream fields{fen};
+	std::string skipped;
+	halfmove_clock = 0;
+	fields >> skipped >> skipped >> skipped >> skipped >> halfmove_clock;
+	halfmove_clock = std::max(halfmove_clock, 0);
+	history_count = 0;
 
 	std::array<sb, 12> b_boards{};
 
@@ -91,6 +110,9 @@ void game_data::set(const std::string &fen, const lookup_tables &lookup_table, c
 		pos--;
 	}
 
+	// the piece type boards use the same layout as b_boards (black first)
+	for (int i{0}; i < 12; i++) { piece_boards[i / 6][i % 6] = b_boards[i]; }
+
 	int white_piece_count{0};
 	int black_piece_count{0};
 
@@ -141,10 +163,59 @@ void game_data::set(const std::string &fen, const lookup_tables &lookup_table, c
 		}
 	}
 
-	update_attack_boards(lookup_table, between_table);
+	update_attack_boards(lookup_table);
+
+	hash_key = compute_hash();
+}
+
+uint8_t game_data::castling_rights() const {
+	// whether the unmoved king on king_idx has an unmoved rook of the same color on rook_idx
+	auto can_castle = [this](const piece_color color, const int king_idx, const int rook_idx) {
+		const auto &pieces{color == piece_color::WHITE ? white_pieces : black_pieces};
+		const sb own_board{color == piece_color::WHITE ? white_board : black_board};
+		const piece_data &king{pieces[15]};
+		if (king.position != sb{1} << king_idx || king.has_moved || !(own_board & sb{1} << rook_idx)) { return false; }
+
+		const piece_data &rook{pieces[piece_lookup[rook_idx]]};
+		return rook.type == piece_type::ROOK && !rook.has_moved;
+	};
+
+	uint8_t rights{0};
+	if (can_castle(piece_color::WHITE, 3, 0)) { rights |= WHITE_KINGSIDE; }
+	if (can_castle(piece_color::WHITE, 3, 7)) { rights |= WHITE_QUEENSIDE; }
+	if (can_castle(piece_color::BLACK, 59, 56)) { rights |= BLACK_KINGSIDE; }
+	if (can_castle(piece_color::BLACK, 59, 63)) { rights |= BLACK_QUEENSIDE; }
+	return rights;
+}
+
+uint64_t game_data::compute_hash() const {
+	uint64_t key{0};
+
+	for (int color{0}; color < 2; color++) {
+		for (int type{0}; type < 6; type++) {
+			sb pieces{piece_boards[color][type]};
+			while (pieces) {
+				key ^= zobrist.pieces[color][type][__builtin_ctzll(pieces)];
+				pieces &= pieces - 1;
+			}
+		}
+	}
+
+	if (side_to_move == piece_color::BLACK) { key ^= zobrist.black_to_move; }
+	key ^= zobrist.castling[castling_rights()];
+	if (en_passant_board) { key ^= zobrist.en_passant_file[sb_to_int(en_passant_board) % 8]; }
+
+	return key;
+}
 
-	update_pins(white_pieces, lookup_table);
-	update_pins(black_pieces, lookup_table);
+bool game_data::is_repetition() const {
+	// the same side has to be to move, so every other position back to the last capture or pawn move (two plies
+	// back can't match, both sides would have to have taken back a move in one)
+	const int reach{std::min({halfmove_clock, history_count, KEY_HISTORY_SIZE})};
+	for (int distance{4}; distance <= reach; distance += 2) {
+		if (key_history[(history_count - distance) % KEY_HISTORY_SIZE] == hash_key) { return true; }
+	}
+	return false;
 }
 
 piece_color game_data::get_color(const sb pos) const {
@@ -154,8 +225,8 @@ piece_color game_data::get_color(const sb pos) const {
 }
 
 piece_data *game_data::get_piece(const int pos) {
-	if (sb{1} << pos & white_board) { return &white_pieces[piece_lookup[sb_to_int(pos)]]; }
-	if (sb{1} << pos & black_board) { return &black_pieces[piece_lookup[sb_to_int(pos)]]; }
+	if (sb{1} << pos & white_board) { return &white_pieces[piece_lookup[pos]]; }
+	if (sb{1} << pos & black_board) { return &black_pieces[piece_lookup[pos]]; }
 	return nullptr;
 }
 
@@ -171,99 +242,6 @@ std::pair<std::array<piece_data, 16> *, std::array<piece_data, 16> *> game_data:
 		       : std::pair{&black_pieces, &white_pieces};
 }
 
-piece_data *game_data::ray_cast_x1(const sb arm, const piece_data &piece) {
-	auto [friendly_board, enemy_board]{get_boards(piece.color)};
-	auto [friendly_pieces, enemy_pieces]{get_pieces(piece.color)};
-
-	// calculate the hits on the arm
-	const sb hits{(*friendly_board | *enemy_board) & arm};
-
-	// return null if no hits
-	if (hits == 0) { return nullptr; }
-
-	int hit_index{0};
-
-	// get msb or lsb and build masks
-	if (arm > piece.position) {
-		// gets the trailing zeros of the board, giving the index of the first hit
-		hit_index = __builtin_ctzll(hits);
-	} else {
-		// gets leading zeros of the board; to get the index, takes this value from 63 (max index of the board)
-		hit_index = 63 - __builtin_clzll(hits);
-	}
-
-	const sb hit_board{sb{1} << hit_index};
-
-	// get the pointer of the piece that got hit
-	piece_data *hit_ptr{
-		(hit_board & *friendly_board)
-			? &((*friendly_pieces)[piece_lookup[hit_index]])
-			: &((*enemy_pieces)[piece_lookup[hit_index]])
-	};
-
-	// return the pointer of the piece
-	return hit_ptr;
-}
-
-std::pair<piece_data *, piece_data *> game_data::ray_cast_x2(const sb arm, const piece_data &piece) {
-	auto [friendly_board, enemy_board]{get_boards(piece.color)};
-	auto [friendly_pieces, enemy_pieces]{get_pieces(piece.color)};
-
-	// calculate the hits on the arm
-	sb hits{(*friendly_board | *enemy_board) & arm};
-
-	// return null if no hits
-	if (hits == 0) { return std::pair{nullptr, nullptr}; }
-
-	int first_hit_index{0};
-
-	// get msb or lsb and build masks
-	if (arm > piece.position) {
-		// gets the trailing zeros of the board, giving the index of the first hit
-		first_hit_index = __builtin_ctzll(hits);
-	} else {
-		// gets leading zeros of the board; to get the index, takes this value from 63 (max index of the board)
-		first_hit_index = 63 - __builtin_clzll(hits);
-	}
-
-	sb hit_board{sb{1} << first_hit_index};
-
-	// get the pointer of the piece that got hit
-	piece_data *first_hit_ptr{
-		(hit_board & *friendly_board)
-			? &((*friendly_pieces)[piece_lookup[first_hit_index]])
-			: &((*enemy_pieces)[piece_lookup[first_hit_index]])
-	};
-
-	hits &= ~hit_board;
-
-	// return first_hit if no hits
-	if (hits == 0) { return std::pair{first_hit_ptr, nullptr}; }
-
-	int second_hit_index{0};
-
-	// get msb or lsb and build masks
-	if (arm > piece.position) {
-		// gets the trailing zeros of the board, giving the index of the first hit
-		second_hit_index = __builtin_ctzll(hits);
-	} else {
-		// gets leading zeros of the board; to get the index, takes this value from 63 (max index of the board)
-		second_hit_index = 63 - __builtin_clzll(hits);
-	}
-
-	hit_board = sb{1} << second_hit_index;
-
-	// get the pointer of the piece that got hit
-	piece_data *second_hit_ptr{
-		(hit_board & *friendly_board)
-			? &((*friendly_pieces)[piece_lookup[second_hit_index]])
-			: &((*enemy_pieces)[piece_lookup[second_hit_index]])
-	};
-
-	// return the pointer of the piece
-	return std::pair{first_hit_ptr, second_hit_ptr};
-}
-
 sb game_data::pawn_logic(const piece_data &piece) {
 	sb output{0};
 
@@ -357,137 +335,86 @@ sb game_data::king_logic(const piece_data &piece, const int pos, const lookup_ta
 	return output;
 }
 
-sb game_data::slider_logic(const piece_data &piece, const lookup_tables &lookup_table,
-                           const between_tables &between_table) {
+sb game_data::slider_logic(const piece_data &piece, const lookup_tables &lookup_table) {
+	auto [friendly_board, enemy_board]{get_boards(piece.color)};
+	const sb occupied{*friendly_board | *enemy_board};
+	const int pos{sb_to_int(piece.position)};
+
 	sb output{0};
-	std::span<const sb> lt{};
 
-	// assign the correct lookup table for the piece trying to move
+	// one magic lookup per slider gives all arms up to and including the first hit
 	switch (piece.type) {
 		case piece_type::BISHOP: {
-			lt = lookup_table.bishop_table[sb_to_int(piece.position)];
+			output = lookup_table.slider_table.bishop_attacks(pos, occupied);
 			break;
 		}
 		case piece_type::ROOK: {
-			lt = lookup_table.rook_table[sb_to_int(piece.position)];
+			output = lookup_table.slider_table.rook_attacks(pos, occupied);
 			break;
 		}
 		case piece_type::QUEEN: {
-			lt = lookup_table.queen_table[sb_to_int(piece.position)];
+			output = lookup_table.slider_table.queen_attacks(pos, occupied);
 			break;
 		}
 		default: break;
 	}
 
-	// iterate over each arm in the lookup table
-	for (const auto &arm: lt) {
-		// ray cast to find first hit
-		const piece_data *hit_ptr = ray_cast_x1(arm, piece);
-		// if no hit, then full arm is valid for movement
-		if (!hit_ptr) {
-			output |= arm;
-			continue;
-		}
-		const piece_data hit = *hit_ptr;
-		// create the possible move set as being the moves between the two positions (first removed, last sometimes)
-		output |= between_table[sb_to_int(piece.position)][sb_to_int(hit.position)] & ~(
-			piece.position | (piece.color == hit.color ? hit.position : sb{0}));
-	}
-
-	return output;
+	// the first hit is only a valid move if it is an enemy
+	return output & ~*friendly_board;
 }
 
-void game_data::update_attack_boards(const lookup_tables &lookup_table, const between_tables &between_table) {
-	side_attacks[static_cast<int>(piece_color::WHITE)] = side_attacks[static_cast<int>(piece_color::BLACK)] = 0;
+sb game_data::piece_attacks(const piece_data &piece, const lookup_tables &lookup_table) const {
+	const int pos{sb_to_int(piece.position)};
 
-	for (int i{0}; i < 64; i++) {
-		if (piece_lookup[i] == 255) { continue; }
+	// sliders see through the enemy king so it can't step back along the attacking arm
+	const sb enemy_king{piece_boards[1 - static_cast<int>(piece.color)][static_cast<int>(piece_type::KING)]};
+	const sb slider_occupancy{(white_board | black_board) & ~enemy_king};
 
-		const piece_color piece_color{get_color(sb{1} << i)};
-		piece_data &piece{
-			piece_color == piece_color::WHITE ? white_pieces[piece_lookup[i]] : black_pieces[piece_lookup[i]]
-		};
+	switch (piece.type) {
+		case piece_type::PAWN: return pawn_attacks(piece.position, piece.color);
+		case piece_type::KNIGHT: return lookup_table.knight_table[pos][0];
+		case piece_type::BISHOP: return lookup_table.slider_table.bishop_attacks(pos, slider_occupancy);
+		case piece_type::ROOK: return lookup_table.slider_table.rook_attacks(pos, slider_occupancy);
+		case piece_type::QUEEN: return lookup_table.slider_table.queen_attacks(pos, slider_occupancy);
+		case piece_type::KING: return lookup_table.king_table[pos][0];
+		default: return 0;
+	}
+}
 
-		piece.attacks = 0;
+void game_data::update_attack_boards(const lookup_tables &lookup_table) {
+	const sb occupied{white_board | black_board};
 
-		auto slider_attacks = [&](const auto &table) {
-			for (const auto &arm: table) {
-				const piece_data *hit_ptr = ray_cast_x1(arm, piece);
+	// per piece attacks (used for evaluation and to find what the incremental update must recompute)
+	for (auto &piece: white_pieces) { piece.attacks = piece.position ? piece_attacks(piece, lookup_table) : 0; }
+	for (auto &piece: black_pieces) { piece.attacks = piece.position ? piece_attacks(piece, lookup_table) : 0; }
 
-				if (!hit_ptr) {
-					piece.attacks |= arm;
-					continue;
-				}
+	// whole side attacks are built set-wise from the piece type boards, a few shifts per direction
+	for (const piece_color color: {piece_color::WHITE, piece_color::BLACK}) {
+		const int side{static_cast<int>(color)};
+		side_attacks[side] = side_attacks_setwise(piece_boards[side], color, occupied,
+		                                          piece_boards[1 - side][static_cast<int>(piece_type::KING)]);
+	}
+}
 
-				if (hit_ptr->type == piece_type::KING && hit_ptr->color != piece.color) {
-					auto [_, temp_hit_ptr] = ray_cast_x2(arm, piece);
-					if (!temp_hit_ptr) {
-						piece.attacks |= arm;
-						continue;
-					}
-					hit_ptr = temp_hit_ptr;
-				}
+void game_data::update_attack_boards(const sb changed, const lookup_tables &lookup_table) {
+	side_attacks = {};
 
-				piece.attacks |= between_table[sb_to_int(piece.position)][sb_to_int(hit_ptr->position)] & ~piece.
-						position;
-			}
-		};
+	for (auto *piece_set: {&white_pieces, &black_pieces}) {
+		for (auto &piece: *piece_set) {
+			if (piece.position == 0) { continue; }
 
-		switch (piece.type) {
-			case piece_type::PAWN: {
-				piece.attacks = piece_color == piece_color::WHITE
-					                ? (piece.position << 7 | piece.position << 9)
-					                : (piece.position >> 7 | piece.position >> 9);
-				break;
+			// a piece's attacks only change if it moved, or it is a slider whose attacks reach a square that changed
+			// (attacks stop at the first piece, so squares further along the arm don't matter)
+			if (piece.position & changed || (piece.is_slider && piece.attacks & changed)) {
+				piece.attacks = piece_attacks(piece, lookup_table);
 			}
-			case piece_type::KNIGHT: {
-				piece.attacks = lookup_table.knight_table[sb_to_int(piece.position)][0];
-				break;
-			}
-			case piece_type::BISHOP: {
-				slider_attacks(lookup_table.bishop_table[sb_to_int(piece.position)]);
-				break;
-			}
-			case piece_type::ROOK: {
-				slider_attacks(lookup_table.rook_table[sb_to_int(piece.position)]);
-				break;
-			}
-			case piece_type::QUEEN: {
-				slider_attacks(lookup_table.queen_table[sb_to_int(piece.position)]);
-				break;
-			}
-			case piece_type::KING: {
-				piece.attacks = lookup_table.king_table[sb_to_int(piece.position)][0];
-				break;
-			}
-			default: { break; }
-		}
 
-		// update side_attacks
-		side_attacks[static_cast<int>(piece.color)] |= piece.attacks;
-	}
-}
-
-void game_data::update_pins(auto &piece_set, const auto &table) {
-	// iterate over all arms for the king
-	if (piece_set[15].position != 0) {
-		for (const auto arm: table.queen_table[sb_to_int(piece_set[15].position)]) {
-			// cast out rays
-			auto [first, second] = ray_cast_x2(arm, piece_set[15]);
-			// continue of not enough pieces on the arm
-			if (!second || !first) { continue; }
-			// check if the piece could be a pinner
-			if (!second->is_slider || second->color == piece_set[15].color) { continue; }
-			// if the second rayed piece has attacks along arm towards king
-			if (second->attacks & arm) {
-				// the first rayed piece is pinned
-				first->pinner_id = second->id;
-			}
+			side_attacks[static_cast<int>(piece.color)] |= piece.attacks;
 		}
 	}
 }
 
-float game_data::evaluate_position(const lookup_tables &lookup_table, const between_tables &between_table) {
+float game_data::evaluate_position(const lookup_tables &lookup_table) {
 	// calculate material diff
 	int material_diff = 0;
 	for (const auto &piece: white_pieces) { material_diff += piece.value; }
@@ -496,52 +423,23 @@ float game_data::evaluate_position(const lookup_tables &lookup_table, const betw
 	// calculate king safety
 	int king_weakness = 0;
 	int king_openness = 0;
-	sb king_controlled = lookup_table.king_table[sb_to_int(white_pieces[15].position)][0];
-	// 1. count the value of pieces attacking around a king
-	for (const auto &piece: black_pieces) { if (king_controlled & piece.attacks) { king_weakness -= piece.value; } }
-	// 2. check how open the king is (how long arms are from all 8 positions around the king)
-	while (king_controlled != 0) {
-		const int target_idx = __builtin_ctzll(king_controlled);
-		const sb target_pos = sb{1} << target_idx;
-
-		for (const auto &arm: lookup_table.queen_table[target_idx]) {
-			const piece_data *hit_ptr = ray_cast_x1(arm, white_pieces[15]);
-
-			if (!hit_ptr) {
-				king_openness -= std::popcount(arm);
-				continue;
-			}
-
-			king_openness -= std::popcount(
-				between_table[sb_to_int(white_pieces[15].position)][sb_to_int(hit_ptr->position)] & ~white_pieces[15].
-				position);
+	const sb occupied = white_board | black_board;
+	for (const auto &[king, enemy_pieces, sign]: {
+		     std::tuple{&white_pieces[15], &black_pieces, -1}, std::tuple{&black_pieces[15], &white_pieces, 1}
+	     }) {
+		if (king->position == 0) { continue; }
+
+		sb king_controlled = lookup_table.king_table[sb_to_int(king->position)][0];
+		// 1. count the value of pieces attacking around a king
+		for (const auto &piece: *enemy_pieces) {
+			if (king_controlled & piece.attacks) { king_weakness += sign * piece.value; }
 		}
-
-		king_controlled &= ~target_pos;
-	}
-
-	king_controlled = lookup_table.king_table[sb_to_int(black_pieces[15].position)][0];
-	// 1. count the value of pieces attacking around a king
-	for (const auto &piece: white_pieces) { if (king_controlled & piece.attacks) { king_weakness += piece.value; } }
-	// 2. check how open the king is (how long arms are from all 8 positions around the king)
-	while (king_controlled != 0) {
-		const int target_idx = __builtin_ctzll(king_controlled);
-		const sb target_pos = sb{1} << target_idx;
-
-		for (const auto &arm: lookup_table.queen_table[target_idx]) {
-			const piece_data *hit_ptr = ray_cast_x1(arm, black_pieces[15]);
-
-			if (!hit_ptr) {
-				king_openness += std::popcount(arm);
-				continue;
-			}
-
-			king_openness += std::popcount(
-				between_table[sb_to_int(white_pieces[15].position)][sb_to_int(hit_ptr->position)] & ~white_pieces[15].
-				position);
+		// 2. check how open the king is (how long arms are from all 8 positions around the king)
+		while (king_controlled != 0) {
+			const int target_idx = __builtin_ctzll(king_controlled);
+			king_openness += sign * std::popcount(lookup_table.slider_table.queen_attacks(target_idx, occupied));
+			king_controlled &= king_controlled - 1;
 		}
-
-		king_controlled &= ~target_pos;
 	}
 
 	// calculate structure
@@ -560,7 +458,96 @@ float game_data::evaluate_position(const lookup_tables &lookup_table, const betw
 	       static_cast<float>(mobility_diff);
 }
 
-sb game_data::get_valid_moves(const int pos, const lookup_tables &lookup_table, const between_tables &between_table) {
+sb game_data::attackers_to(const int pos, const sb occupied, const lookup_tables &lookup_table) const {
+	const auto &white{piece_boards[static_cast<int>(piece_color::WHITE)]};
+	const auto &black{piece_boards[static_cast<int>(piece_color::BLACK)]};
+	const sb target{sb{1} << pos};
+
+	const sb knights{white[static_cast<int>(piece_type::KNIGHT)] | black[static_cast<int>(piece_type::KNIGHT)]};
+	const sb kings{white[static_cast<int>(piece_type::KING)] | black[static_cast<int>(piece_type::KING)]};
+	const sb queens{white[static_cast<int>(piece_type::QUEEN)] | black[static_cast<int>(piece_type::QUEEN)]};
+	const sb rooks{white[static_cast<int>(piece_type::ROOK)] | black[static_cast<int>(piece_type::ROOK)] | queens};
+	const sb bishops{
+		white[static_cast<int>(piece_type::BISHOP)] | black[static_cast<int>(piece_type::BISHOP)] | queens
+	};
+
+	// a pawn attacks pos if a pawn of the other color standing on pos would attack it
+	return (pawn_attacks(target, piece_color::BLACK) & white[static_cast<int>(piece_type::PAWN)])
+	       | (pawn_attacks(target, piece_color::WHITE) & black[static_cast<int>(piece_type::PAWN)])
+	       | (lookup_table.knight_table[pos][0] & knights)
+	       | (lookup_table.king_table[pos][0] & kings)
+	       | (lookup_table.slider_table.rook_attacks(pos, occupied) & rooks)
+	       | (lookup_table.slider_table.bishop_attacks(pos, occupied) & bishops);
+}
+
+position_masks game_data::get_position_masks(const piece_color color, const lookup_tables &lookup_table,
+                                             const between_tables &between_table) const {
+	position_masks masks;
+	masks.checkers = 0;
+	masks.evasion_mask = ~sb{0};
+	masks.pinned = 0;
+
+	const sb king{piece_boards[static_cast<int>(color)][static_cast<int>(piece_type::KING)]};
+	if (king == 0) { return masks; }
+
+	const int king_idx{sb_to_int(king)};
+	const sb friendly_board{color == piece_color::WHITE ? white_board : black_board};
+	const sb enemy_board{color == piece_color::WHITE ? black_board : white_board};
+	const auto &enemy{piece_boards[1 - static_cast<int>(color)]};
+	const sb enemy_queens{enemy[static_cast<int>(piece_type::QUEEN)]};
+	const sb enemy_rooks{enemy[static_cast<int>(piece_type::ROOK)] | enemy_queens};
+	const sb enemy_bishops{enemy[static_cast<int>(piece_type::BISHOP)] | enemy_queens};
+
+	masks.checkers = attackers_to(king_idx, white_board | black_board, lookup_table) & enemy_board;
+
+	// one checker can be taken (or blocked if it slides), two can only be escaped by the king
+	if (masks.checkers & (masks.checkers - 1)) {
+		masks.evasion_mask = 0;
+	} else if (masks.checkers) {
+		masks.evasion_mask = masks.checkers & (enemy_rooks | enemy_bishops)
+			                     ? between_table[king_idx][sb_to_int(masks.checkers)]
+			                     : masks.checkers;
+	}
+
+	// sliders that would hit the king if only enemy pieces blocked, a single friendly piece in between is pinned
+	sb snipers{
+		(lookup_table.slider_table.rook_attacks(king_idx, enemy_board) & enemy_rooks)
+		| (lookup_table.slider_table.bishop_attacks(king_idx, enemy_board) & enemy_bishops)
+	};
+	while (snipers) {
+		const int sniper_idx{__builtin_ctzll(snipers)};
+		snipers &= snipers - 1;
+
+		const sb ray{between_table[king_idx][sniper_idx]};
+		const sb blockers{ray & friendly_board & ~king};
+		if (blockers && (blockers & (blockers - 1)) == 0) {
+			masks.pinned |= blockers;
+			masks.pin_rays[sb_to_int(blockers)] = ray;
+		}
+	}
+
+	return masks;
+}
+
+bool game_data::en_passant_exposes_king(const int from_idx, const piece_color color,
+                                        const lookup_tables &lookup_table) const {
+	const sb king{piece_boards[static_cast<int>(color)][static_cast<int>(piece_type::KING)]};
+	if (king == 0) { return false; }
+
+	// the capturing pawn leaves from_idx, lands behind the double moved pawn, and that pawn disappears
+	const sb target{color == piece_color::WHITE ? en_passant_board << 8 : en_passant_board >> 8};
+	const sb occupied{((white_board | black_board) & ~(sb{1} << from_idx) & ~en_passant_board) | target};
+
+	const auto &enemy{piece_boards[1 - static_cast<int>(color)]};
+	const sb enemy_sliders{
+		enemy[static_cast<int>(piece_type::BISHOP)] | enemy[static_cast<int>(piece_type::ROOK)]
+		| enemy[static_cast<int>(piece_type::QUEEN)]
+	};
+
+	return attackers_to(sb_to_int(king), occupied, lookup_table) & enemy_sliders;
+}
+
+sb game_data::get_pseudo_moves(const int pos, const lookup_tables &lookup_table) {
 	sb output{0};
 	// get the piece
 	const piece_color piece_color{get_color(sb{1} << pos)};
@@ -586,73 +573,117 @@ sb game_data::get_valid_moves(const int pos, const lookup_tables &lookup_table,
 		case piece_type::BISHOP:
 		case piece_type::ROOK:
 		case piece_type::QUEEN: {
-			output = slider_logic(piece, lookup_table, between_table);
+			output = slider_logic(piece, lookup_table);
 			break;
 		}
 		default: break;
 	}
 
-	// if the piece is pinned
-	if (piece.pinner_id != 255) {
-		auto [friendly_pieces, enemy_pieces]{get_pieces(piece.color)};
-		// get the pinner
-		const piece_data &pinner{(*enemy_pieces)[piece.pinner_id]};
+	return output;
+}
+
+sb game_data::get_legal_moves(const int pos, const position_masks &masks, const lookup_tables &lookup_table) {
+	sb output{get_pseudo_moves(pos, lookup_table)};
+	const sb pos_board{sb{1} << pos};
 
-		// because we can guarantee being pinned, valid moves must only be on the line between pinner and king
-		if ((*friendly_pieces)[15].position != 0) {
-			output &= between_table[sb_to_int(pinner.position)][sb_to_int((*friendly_pieces)[15].position)];
-		}
+	// king moves already avoid attacked squares
+	const piece_color color{get_color(pos_board)};
+	if (pos_board & piece_boards[static_cast<int>(color)][static_cast<int>(piece_type::KING)]) { return output; }
+
+	sb allowed{masks.evasion_mask};
+	sb en_passant_target{0};
+	if (pos_board & piece_boards[static_cast<int>(color)][static_cast<int>(piece_type::PAWN)] && en_passant_board) {
+		en_passant_target = output & (color == piece_color::WHITE ? en_passant_board << 8 : en_passant_board >> 8);
 	}
 
-	return output;
+	// taking en passant removes a pawn that isn't on the target square, so it also answers a check from that pawn
+	if (en_passant_target && masks.checkers & en_passant_board) { allowed |= en_passant_target; }
+	if (masks.pinned & pos_board) { allowed &= masks.pin_rays[pos]; }
+	if (en_passant_target && en_passant_exposes_king(pos, color, lookup_table)) { allowed &= ~en_passant_target; }
+
+	return output & allowed;
+}
+
+sb game_data::get_valid_moves(const int pos, const lookup_tables &lookup_table, const between_tables &between_table) {
+	const piece_color color{get_color(sb{1} << pos)};
+	if (color == piece_color::NONE) { return 0; }
+
+	position_masks masks{get_position_masks(color, lookup_table, between_table)};
+	masks.evasion_mask = ~sb{0};
+	masks.checkers = 0;
+	return get_legal_moves(pos, masks, lookup_table);
 }
 
-void game_data::move(const int old_idx, const int new_idx, const lookup_tables &lookup_table,
-                     const between_tables &between_table) {
+void game_data::relocate(piece_data &piece, const int from_idx, const int to_idx) {
+	auto [friendly_board, enemy_board] = get_boards(piece.color);
+	const sb new_pos{sb{1} << to_idx};
+
+	// update game data
+	piece_lookup[from_idx] = 255;
+	piece_lookup[to_idx] = piece.id;
+	*friendly_board &= ~piece.position;
+	*friendly_board |= new_pos;
+
+	sb &type_board{piece_boards[static_cast<int>(piece.color)][static_cast<int>(piece.type)]};
+	type_board &= ~piece.position;
+	type_board |= new_pos;
+
+	const auto &keys{zobrist.pieces[static_cast<int>(piece.color)][static_cast<int>(piece.type)]};
+	hash_key ^= keys[from_idx] ^ keys[to_idx];
+
+	// update piece data
+	piece.position = new_pos;
+}
+
+void game_data::move(const int old_idx, const int new_idx, const lookup_tables &lookup_table) {
 	// get the piece
 	const piece_color piece_color{get_color(sb{1} << old_idx)};
+	if (piece_color == piece_color::NONE) { return; }
 	piece_data *piece{
 		piece_color == piece_color::WHITE ? &white_pieces[piece_lookup[old_idx]] : &black_pieces[piece_lookup[old_idx]]
 	};
 
-	// remove all prev pins if king moves
-	if (piece->type == piece_type::KING) {
-		// iterate over all arms
-		for (const auto arm: lookup_table.queen_table[sb_to_int(piece->position)]) {
-			// cast out rays
-			piece_data *rayed_piece = ray_cast_x1(arm, *piece);
-			// if there is a piece on the ray, remove any pin
-			if (rayed_piece) { rayed_piece->pinner_id = 255; }
-		}
-	}
-
 	// get boards
 	auto [friendly_board, enemy_board] = get_boards(piece->color);
+	auto [friendly_pieces, enemy_pieces] = get_pieces(piece->color);
+
+	// the squares whose occupancy changes, used to find which attacks need recomputing
+	sb changed{sb{1} << old_idx | sb{1} << new_idx};
+
+	key_history[history_count++ % KEY_HISTORY_SIZE] = hash_key;
+	halfmove_clock = piece->type == piece_type::PAWN ? 0 : halfmove_clock + 1;
+
+	// castling rights and en passant are hashed as a whole, so take the old ones out now and put the new ones in last
+	hash_key ^= zobrist.castling[castling_rights()];
+	if (en_passant_board) { hash_key ^= zobrist.en_passant_file[sb_to_int(en_passant_board) % 8]; }
+
+	// a diagonal pawn move onto an empty square is en passant, the captured pawn is the one that just double moved
+	int captured_idx{new_idx};
+	if (piece->type == piece_type::PAWN && piece_lookup[new_idx] == 255 && (new_idx - old_idx) % 8 != 0) {
+		captured_idx = sb_to_int(en_passant_board);
+		changed |= en_passant_board;
+	}
 
 	// update captured piece
-	if (piece_lookup[new_idx] != 255) {
+	if (piece_lookup[captured_idx] != 255) {
 		// get the captured piece (will always be the opposite color)
-		piece_data *captured_piece = piece_color == piece_color::WHITE
-			                             ? &black_pieces[piece_lookup[old_idx]]
-			                             : &white_pieces[piece_lookup[old_idx]];
+		piece_data *captured_piece = &(*enemy_pieces)[piece_lookup[captured_idx]];
 		*enemy_board &= ~captured_piece->position;
+		sb &captured_board{
+			piece_boards[static_cast<int>(captured_piece->color)][static_cast<int>(captured_piece->type)]
+		};
+		captured_board &= ~captured_piece->position;
+		piece_lookup[captured_idx] = 255;
+		hash_key ^= zobrist.pieces[static_cast<int>(captured_piece->color)][static_cast<int>(captured_piece->type)][
+			captured_idx];
 		captured_piece->reset();
+		halfmove_clock = 0;
 	}
 
-	auto update_data = [&](auto *piece_data, sb new_pos) {
-		// update game data
-		piece_lookup[old_idx] = 255;
-		piece_lookup[new_idx] = piece_data->id;
-		*friendly_board &= ~piece_data->position;
-		*friendly_board |= new_pos;
-
-		// update piece data
-		piece_data->position = new_pos;
-		piece_data->has_moved = true;
-	};
+	relocate(*piece, old_idx, new_idx);
+	piece->has_moved = true;
 
-	const sb new_pos{sb{1} << new_idx};
-	update_data(piece, new_pos);
+	set_side_to_move(piece_color == piece_color::WHITE ? piece_color::BLACK : piece_color::WHITE);
 
 	// en passant updates
 	if (piece->type == piece_type::PAWN && abs(new_idx - old_idx) == 16) {
@@ -663,35 +694,117 @@ void game_data::move(const int old_idx, const int new_idx, const lookup_tables &
 		en_passant_board = 0;
 	}
 
-	// castling updates
-	if (piece->type == piece_type::KING && (lookup_table.king_table[old_idx][0] & new_pos) == 0) {
-		auto [friendly_pieces, enemy_pieces] = get_pieces(piece->color);
+	// castling updates (the rook sits 4 squares towards the a-file or 3 towards the h-file from the king's start)
+	if (piece->type == piece_type::KING && (lookup_table.king_table[old_idx][0] & piece->position) == 0) {
+		const int rook_old_idx{new_idx > old_idx ? old_idx + 4 : old_idx - 3};
+		const int rook_new_idx{new_idx > old_idx ? new_idx - 1 : new_idx + 1};
 
-		piece_data *castle_partner;
-		sb castle_partner_pos{};
-		if (new_idx > old_idx) {
-			// get the position of the rook and its piece data
-			castle_partner_pos = piece->position << 4;
-			castle_partner = &(*friendly_pieces)[piece_lookup[sb_to_int(castle_partner_pos)]];
+		piece_data &castle_partner{(*friendly_pieces)[piece_lookup[rook_old_idx]]};
+		relocate(castle_partner, rook_old_idx, rook_new_idx);
+		castle_partner.has_moved = true;
+		changed |= sb{1} << rook_old_idx | sb{1} << rook_new_idx;
+	}
 
-			update_data(castle_partner, piece->position << 1);
-		} else {
-			// get the position of the rook and its piece data
-			castle_partner_pos = piece->position >> 3;
-			castle_partner = &(*friendly_pieces)[piece_lookup[sb_to_int(castle_partner_pos)]];
+	hash_key ^= zobrist.castling[castling_rights()];
+	if (en_passant_board) { hash_key ^= zobrist.en_passant_file[sb_to_int(en_passant_board) % 8]; }
 
-			update_data(castle_partner, piece->position >> 1);
-		}
+	// update attacks
+	update_attack_boards(changed, lookup_table);
+}
+
+void game_data::make_move(const chess_move move, undo_stack &stack, const lookup_tables &lookup_table) {
+	undo_record &undo{stack.emplace_back()};
+	const int from{move.from()};
+	const int to{move.to()};
+
+	// save the captured piece (for en passant it is the pawn that double moved, not the target square)
+	const int captured_idx{move.flag() == move_flag::EN_PASSANT ? sb_to_int(en_passant_board) : to};
+	if (move.is_capture()) { undo.captured = *get_piece(captured_idx); }
+
+	undo.en_passant_board = en_passant_board;
+	undo.side_to_move = side_to_move;
+	undo.hash_key = hash_key;
+	undo.halfmove_clock = halfmove_clock;
+	undo.side_attacks = side_attacks;
+	for (int i{0}; i < 16; i++) {
+		undo.attacks[0][i] = black_pieces[i].attacks;
+		undo.attacks[1][i] = white_pieces[i].attacks;
 	}
 
-	// update attacks
-	update_attack_boards(lookup_table, between_table);
+	// has_moved of the piece (and the rook when castling)
+	undo.had_moved = get_piece(from)->has_moved;
+	if (move.flag() == move_flag::CASTLE) {
+		undo.rook_had_moved = get_piece(to > from ? from + 4 : from - 3)->has_moved;
+	}
+
+	this->move(from, to, lookup_table);
+}
+
+void game_data::unmake_move(const chess_move move, undo_stack &stack) {
+	const undo_record &undo{stack.back()};
+	const int from{move.from()};
+	const int to{move.to()};
+
+	// put the piece back
+	piece_data &piece{*get_piece(to)};
+	relocate(piece, to, from);
+	piece.has_moved = undo.had_moved;
+
+	if (move.flag() == move_flag::CASTLE) {
+		const int rook_old_idx{to > from ? from + 4 : from - 3};
+		const int rook_new_idx{to > from ? to - 1 : to + 1};
 
-	// update pins
-	auto [friendly_pieces, enemy_pieces]{get_pieces(piece->color)};
+		piece_data &castle_partner{*get_piece(rook_new_idx)};
+		relocate(castle_partner, rook_new_idx, rook_old_idx);
+		castle_partner.has_moved = undo.rook_had_moved;
+	}
+
+	// bring back the captured piece into its old slot
+	if (move.is_capture()) {
+		const piece_data &captured{undo.captured};
+		auto [enemy_board, _] = get_boards(captured.color);
+		auto [enemy_pieces, __] = get_pieces(captured.color);
+
+		(*enemy_pieces)[captured.id] = captured;
+		*enemy_board |= captured.position;
+		piece_boards[static_cast<int>(captured.color)][static_cast<int>(captured.type)] |= captured.position;
+		piece_lookup[sb_to_int(captured.position)] = captured.id;
+	}
+
+	en_passant_board = undo.en_passant_board;
+	side_to_move = undo.side_to_move;
+	hash_key = undo.hash_key;
+	halfmove_clock = undo.halfmove_clock;
+	history_count--;
+	side_attacks = undo.side_attacks;
+	for (int i{0}; i < 16; i++) {
+		black_pieces[i].attacks = undo.attacks[0][i];
+		white_pieces[i].attacks = undo.attacks[1][i];
+	}
+
+	stack.pop_back();
+}
+
+void game_data::make_null_move(undo_stack &stack) {
+	undo_record &undo{stack.emplace_back()};
+	undo.en_passant_board = en_passant_board;
+	undo.side_to_move = side_to_move;
+	undo.hash_key = hash_key;
+	undo.halfmove_clock = halfmove_clock;
+	halfmove_clock = 0;
+
+	// nothing moves, so the attack boards stay as they are, only the en passant chance is lost
+	if (en_passant_board) { hash_key ^= zobrist.en_passant_file[sb_to_int(en_passant_board) % 8]; }
+	en_passant_board = 0;
+	set_side_to_move(side_to_move == piece_color::WHITE ? piece_color::BLACK : piece_color::WHITE);
+}
 
-	// reminder! all arms must include the current position of the piece so the pins re-update on king move!
+void game_data::unmake_null_move(undo_stack &stack) {
+	const undo_record &undo{stack.back()};
+	en_passant_board = undo.en_passant_board;
+	side_to_move = undo.side_to_move;
+	hash_key = undo.hash_key;
+	halfmove_clock = undo.halfmove_clock;
 
-	update_pins(*friendly_pieces, lookup_table);
-	update_pins(*enemy_pieces, lookup_table);
+	stack.pop_back();
 }
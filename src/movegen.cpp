@@ -0,0 +1,261 @@
+#include "../include/movegen.h"
+#include "../include/setwise.h"
+
+#include <utility>
+
+namespace {
+	// every legal target of the piece on from, only generated the first time it is asked for
+	sb legal_targets(game_data &gd, const position_masks &masks, target_cache &cache, const int from,
+	                 const lookup_tables &lookup_table) {
+		const sb from_pos{sb{1} << from};
+		if (!(cache.known & from_pos)) {
+			cache.targets[from] = gd.get_legal_moves(from, masks, lookup_table);
+			cache.known |= from_pos;
+		}
+		return cache.targets[from];
+	}
+
+	// appends the legal moves of the piece on from that land on a square in target_filter
+	void append_piece_moves(game_data &gd, move_list &list, const position_masks &masks, target_cache &cache,
+	                        const int from, const sb target_filter, const lookup_tables &lookup_table) {
+		auto [friendly_pieces, enemy_pieces]{gd.get_pieces(gd.side_to_move)};
+		auto [friendly_board, enemy_board]{gd.get_boards(gd.side_to_move)};
+		const piece_data &piece{(*friendly_pieces)[gd.piece_lookup[from]]};
+
+		sb targets{legal_targets(gd, masks, cache, from, lookup_table) & target_filter};
+
+		while (targets) {
+			const int to{__builtin_ctzll(targets)};
+			const sb to_pos{sb{1} << to};
+			targets &= targets - 1;
+
+			move_flag flag{to_pos & *enemy_board ? move_flag::CAPTURE : move_flag::QUIET};
+
+			if (piece.type == piece_type::PAWN) {
+				// a diagonal pawn move onto an empty square can only be en passant
+				if (flag == move_flag::QUIET && (to - from) % 8 != 0) { flag = move_flag::EN_PASSANT; }
+				if (to - from == 16 || from - to == 16) { flag = move_flag::DOUBLE_PUSH; }
+			} else if (piece.type == piece_type::KING && (lookup_table.king_table[from][0] & to_pos) == 0) {
+				flag = move_flag::CASTLE;
+			}
+
+			list.push(chess_move(from, to, flag));
+		}
+	}
+
+	// appends one pawn move per square in targets, coming from step squares back
+	void append_pawn_set(move_list &list, sb targets, const int step, const move_flag flag) {
+		while (targets) {
+			const int to{__builtin_ctzll(targets)};
+			targets &= targets - 1;
+			list.push(chess_move(to - step, to, flag));
+		}
+	}
+
+	// which moves append_moves adds, en passant counts as a capture
+	enum class move_kind : uint8_t {
+		ALL,
+		CAPTURES,
+		QUIETS
+	};
+
+	// appends the legal moves of every piece of the given kind
+	void append_moves(game_data &gd, move_list &list, const position_masks &masks, target_cache &cache,
+	                  const move_kind kind, const lookup_tables &lookup_table) {
+		const piece_color color{gd.side_to_move};
+		auto [friendly_pieces, enemy_pieces]{gd.get_pieces(color)};
+		auto [friendly_board, enemy_board]{gd.get_boards(color)};
+
+		// in double check only the king can move
+		sb own_board{*friendly_board};
+		if (masks.evasion_mask == 0) { own_board &= (*friendly_pieces)[15].position; }
+
+		const sb en_passant_target{
+			color == piece_color::WHITE ? gd.en_passant_board << 8 : gd.en_passant_board >> 8
+		};
+
+		// the target squares for each kind, only a pawn captures onto the empty en passant square
+		const sb piece_filter{
+			kind == move_kind::ALL ? ~sb{0} : kind == move_kind::CAPTURES ? *enemy_board : ~*enemy_board
+		};
+		const sb pawn_filter{
+			kind == move_kind::ALL
+				? ~sb{0}
+				: kind == move_kind::CAPTURES
+				? *enemy_board | en_passant_target
+				: ~(*enemy_board | en_passant_target)
+		};
+
+		// unpinned pawns are done all at once, pinned pawns and en passant go one at a time below
+		const sb pawns{own_board & gd.piece_boards[static_cast<int>(color)][static_cast<int>(piece_type::PAWN)]};
+		const sb free_pawns{pawns & ~masks.pinned};
+
+		if (free_pawns) {
+			const sb empty{~(*friendly_board | *enemy_board)};
+			const sb allowed{masks.evasion_mask};
+			const pawn_move_sets sets{pawn_moves(free_pawns, color, empty, *enemy_board, 0)};
+
+			if (kind != move_kind::QUIETS) {
+				append_pawn_set(list, sets.a_side_captures & allowed, sets.a_side_step, move_flag::CAPTURE);
+				append_pawn_set(list, sets.h_side_captures & allowed, sets.h_side_step, move_flag::CAPTURE);
+			}
+			if (kind != move_kind::CAPTURES) {
+				append_pawn_set(list, sets.single_pushes & allowed, sets.push_step, move_flag::QUIET);
+				append_pawn_set(list, sets.double_pushes & allowed, 2 * sets.push_step, move_flag::DOUBLE_PUSH);
+			}
+		}
+
+		own_board &= ~free_pawns;
+
+		// the free pawns next to the en passant target (an enemy pawn standing there would attack them)
+		const piece_color enemy_color{color == piece_color::WHITE ? piece_color::BLACK : piece_color::WHITE};
+		own_board |= free_pawns & pawn_attacks(en_passant_target & pawn_filter, enemy_color);
+
+		const sb own_pawns{gd.piece_boards[static_cast<int>(color)][static_cast<int>(piece_type::PAWN)]};
+		while (own_board) {
+			const int from{__builtin_ctzll(own_board)};
+			const sb from_pos{sb{1} << from};
+			own_board &= own_board - 1;
+
+			// a free pawn that got here only has its en passant left to add
+			const sb filter{
+				from_pos & free_pawns ? en_passant_target : from_pos & own_pawns ? pawn_filter : piece_filter
+			};
+			append_piece_moves(gd, list, masks, cache, from, filter, lookup_table);
+		}
+	}
+}
+
+void move_history::record_cutoff(const piece_color color, const int ply, const chess_move move, const int depth) {
+	if (move != killers[ply][0]) {
+		killers[ply][1] = killers[ply][0];
+		killers[ply][0] = move;
+	}
+
+	auto &table{butterfly[static_cast<int>(color)]};
+	int &score{table[move.from()][move.to()]};
+	score += depth * depth;
+	if (score > HISTORY_MAX) {
+		for (auto &from: table) {
+			for (int &to: from) { to /= 2; }
+		}
+	}
+}
+
+void move_history::clear() {
+	killers = {};
+	butterfly = {};
+}
+
+void generate_legal_moves(game_data &gd, move_list &list, const lookup_tables &lookup_table,
+                          const between_tables &between_table) {
+	list.size = 0;
+
+	// checkers, evasion squares and pin rays are worked out once here, each piece then only needs an AND
+	const position_masks masks{gd.get_position_masks(gd.side_to_move, lookup_table, between_table)};
+	target_cache cache;
+	append_moves(gd, list, masks, cache, move_kind::ALL, lookup_table);
+}
+
+move_picker::move_picker(game_data &gd, const chess_move hash_move, const lookup_tables &lookup_table,
+                         const between_tables &between_table, const bool captures_only,
+                         const move_history *history, const int ply)
+	: gd(gd), lookup_table(lookup_table),
+	  masks(gd.get_position_masks(gd.side_to_move, lookup_table, between_table)), hash_move(hash_move),
+	  captures_only(captures_only), history(history), ply(ply) {}
+
+bool move_picker::is_hash_move_legal() {
+	if (hash_move.is_null() || (captures_only && !hash_move.is_capture())) { return false; }
+	if (gd.get_color(sb{1} << hash_move.from()) != gd.side_to_move) { return false; }
+
+	// the hash move may come from another position (or a key collision), so it is only used if this position
+	// generates exactly the same move
+	append_piece_moves(gd, moves, masks, targets, hash_move.from(), sb{1} << hash_move.to(), lookup_table);
+	const bool is_legal{moves.size == 1 && moves.moves[0] == hash_move};
+	moves.size = 0;
+
+	return is_legal;
+}
+
+void move_picker::score_captures() {
+	for (int i{0}; i < moves.size; i++) {
+		const chess_move move{moves.moves[i]};
+		// en passant lands on an empty square but always takes a pawn
+		const int victim{move.flag() == move_flag::EN_PASSANT ? PAWN_VALUE : gd.get_piece(move.to())->value};
+		const int attacker{gd.get_piece(move.from())->value};
+		// attacker / 100 is at most 20, less than the 32 * 10 between the two closest victims (bishop and knight)
+		scores[i] = victim * 32 - attacker / 100;
+	}
+}
+
+void move_picker::score_quiets() {
+	for (int i{0}; i < moves.size; i++) {
+		const chess_move move{moves.moves[i]};
+		if (history == nullptr) {
+			scores[i] = 0;
+		} else if (move == history->killers[ply][0]) {
+			scores[i] = move_history::HISTORY_MAX + 2;
+		} else if (move == history->killers[ply][1]) {
+			scores[i] = move_history::HISTORY_MAX + 1;
+		} else {
+			scores[i] = history->butterfly[static_cast<int>(gd.side_to_move)][move.from()][move.to()];
+		}
+	}
+}
+
+void move_picker::pick_best() {
+	int best{index};
+	for (int i{index + 1}; i < moves.size; i++) {
+		if (scores[i] > scores[best]) { best = i; }
+	}
+
+	std::swap(moves.moves[index], moves.moves[best]);
+	std::swap(scores[index], scores[best]);
+}
+
+chess_move move_picker::next() {
+	switch (current_stage) {
+		case stage::HASH_MOVE: {
+			current_stage = stage::GENERATE_CAPTURES;
+			if (is_hash_move_legal()) { return hash_move; }
+			hash_move = chess_move{};
+			[[fallthrough]];
+		}
+		case stage::GENERATE_CAPTURES: {
+			append_moves(gd, moves, masks, targets, move_kind::CAPTURES, lookup_table);
+			score_captures();
+			current_stage = stage::CAPTURES;
+			[[fallthrough]];
+		}
+		case stage::CAPTURES: {
+			while (index < moves.size) {
+				pick_best();
+				const chess_move move{moves.moves[index++]};
+				if (move != hash_move) { return move; }
+			}
+			current_stage = captures_only ? stage::DONE : stage::GENERATE_QUIETS;
+			if (captures_only) { break; }
+			[[fallthrough]];
+		}
+		case stage::GENERATE_QUIETS: {
+			moves.size = 0;
+			index = 0;
+			append_moves(gd, moves, masks, targets, move_kind::QUIETS, lookup_table);
+			score_quiets();
+			current_stage = stage::QUIETS;
+			[[fallthrough]];
+		}
+		case stage::QUIETS: {
+			while (index < moves.size) {
+				pick_best();
+				const chess_move move{moves.moves[index++]};
+				if (move != hash_move) { return move; }
+			}
+			current_stage = stage::DONE;
+			[[fallthrough]];
+		}
+		case stage::DONE: break;
+	}
+
+	return chess_move{};
+}
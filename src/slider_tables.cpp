@@ -0,0 +1,183 @@
+#include "../include/types.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+// magics found by the search in init_magics, stored so startup only has to verify them
+// (square indexing is the same as the rest of the board, 0 = h1)
+constexpr std::array<sb, 64> bishop_seed_magics{
+	0x10102002004A1420ULL, 0x8020040400584008ULL, 0x10510800811201C8ULL, 0x5204042080000088ULL,
+	0x2204106880000002ULL, 0x1401042004000000ULL, 0x0400880410042004ULL, 0x0028208200A02020ULL,
+	0x1500241990010E00ULL, 0x8001200182020A40ULL, 0x40004101030B0000ULL, 0x8002041042000100ULL,
+	0x4010011041020038ULL, 0x0000010421044000ULL, 0x1500210808020A00ULL, 0x8000088400880520ULL,
+	0x0405004010040100ULL, 0x1005823210040108ULL, 0x2708008102040011ULL, 0x4048200404009100ULL,
+	0x0018104101400024ULL, 0x0003000601190101ULL, 0x8004803108491000ULL, 0x8014241200820800ULL,
+	0x0006E080100C3040ULL, 0x0501044A11041800ULL, 0x9020300008004045ULL, 0x0894080000220040ULL,
+	0x1001010083104000ULL, 0x5004030040900080ULL, 0x000400422C012400ULL, 0x0002128698404812ULL,
+	0x1010108404900440ULL, 0x0928021182084100ULL, 0x2006080409020024ULL, 0x1010202020180080ULL,
+	0xA010008200202200ULL, 0x2098015100019004ULL, 0x0002041440810811ULL, 0x802A02020000B098ULL,
+	0x0009015090004060ULL, 0x4000821082081001ULL, 0x0100210040420800ULL, 0x0800004010488A00ULL,
+	0x2000081104004040ULL, 0x4C8E029015000082ULL, 0x0420340322224842ULL, 0x1298260043400210ULL,
+	0x0000822802400008ULL, 0x00008A0101600000ULL, 0x3040003412080021ULL, 0x3040290220884800ULL,
+	0x4A1500401041004AULL, 0x8010200282020781ULL, 0x0020203142209091ULL, 0x0070300600902110ULL,
+	0x0040808800B62048ULL, 0x0000810400C44420ULL, 0x00080400440C0441ULL, 0x8340080020840411ULL,
+	0x0000000104208200ULL, 0x0000800810D00080ULL, 0x0400530411080200ULL, 0x4040702400932244ULL
+};
+
+constexpr std::array<sb, 64> rook_seed_magics{
+	0x1080004008801020ULL, 0x0840092002C03000ULL, 0x1900200010400900ULL, 0x0880100008000480ULL,
+	0x4200100420080200ULL, 0x8100020100080400ULL, 0x0200040110886200ULL, 0x0200008040220411ULL,
+	0x0404800084400220ULL, 0x0000401000402000ULL, 0x0086001081220440ULL, 0x0408800800100280ULL,
+	0x000A001201040820ULL, 0x8848800200840080ULL, 0x4001000100040200ULL, 0x0442000102105084ULL,
+	0x9080010020804100ULL, 0x0040404000201009ULL, 0x0000808010002009ULL, 0x2200090021D00100ULL,
+	0x0008008008040080ULL, 0x0004004002010040ULL, 0x0011040008015042ULL, 0x00000A0001768104ULL,
+	0x0000800080204009ULL, 0x2010004140002001ULL, 0x9800200280100080ULL, 0x1000100080080080ULL,
+	0x0442000A00049020ULL, 0x2100040080020080ULL, 0x0800120400900148ULL, 0x0010040A00128541ULL,
+	0x2800804000800030ULL, 0x1010002000400041ULL, 0x4000200011004100ULL, 0x0610008410800800ULL,
+	0x0400802402800800ULL, 0xC100020080800400ULL, 0x0002000802000401ULL, 0x0182085882000401ULL,
+	0x0220204000808000ULL, 0x2860100040024022ULL, 0x0001002004110040ULL, 0x99101042000A0020ULL,
+	0x0004080004008080ULL, 0x0010040002008080ULL, 0x2012004881020004ULL, 0x8300842444820011ULL,
+	0x0088403882010200ULL, 0x0820400080210100ULL, 0x0110910040A00300ULL, 0x0801100280080480ULL,
+	0x0242009008200600ULL, 0x1002000489500200ULL, 0x0040800200010080ULL, 0x0091800041000080ULL,
+	0x0000209300488001ULL, 0x04C1002414824001ULL, 0x020020000B001041ULL, 0x7000100004200901ULL,
+	0x8002002004100802ULL, 0x30010002084C0007ULL, 0x0888221800813004ULL, 0x4000002840840112ULL
+};
+
+sb slider_tables::arm_attacks(const std::span<const sb> arms, const int pos, const sb occupancy) {
+	const sb position{sb{1} << pos};
+	sb output{0};
+
+	for (const sb arm: arms) {
+		const sb hits{arm & occupancy};
+
+		// if no hit, then the full arm is attacked
+		if (hits == 0) {
+			output |= arm;
+			continue;
+		}
+
+		// keep everything up to and including the first hit
+		if (arm > position) {
+			const int hit_index{__builtin_ctzll(hits)};
+			output |= arm & (hit_index == 63 ? ~sb{0} : (sb{2} << hit_index) - 1);
+		} else {
+			const int hit_index{63 - __builtin_clzll(hits)};
+			output |= arm & ~((sb{1} << hit_index) - 1);
+		}
+	}
+
+	return output;
+}
+
+void slider_tables::init_magics(std::array<magic_entry, 64> &magics, const lb<4> &arm_table,
+                                const std::array<sb, 64> &seed_magics, const slider_backend table_backend,
+                                std::vector<sb> &table) {
+	// xorshift generator with a fixed seed so the tables are the same every run
+	sb seed{0x9E3779B97F4A7C15ULL};
+	auto random = [&seed] {
+		seed ^= seed >> 12;
+		seed ^= seed << 25;
+		seed ^= seed >> 27;
+		return seed * 0x2545F4914F6CDD1DULL;
+	};
+
+	std::array<sb, 4096> occupancies{};
+	std::array<sb, 4096> attacks{};
+	std::array<int, 4096> epoch{};
+	std::array<sb, 4096> used{};
+
+	for (int i{0}; i < 64; i++) {
+		const sb position{sb{1} << i};
+		magic_entry &entry{magics[i]};
+
+		// the relevant occupancy is every arm minus its last square, as a piece there can not block anything
+		entry.mask = 0;
+		for (const sb arm: arm_table[i]) {
+			if (arm == 0) { continue; }
+			const sb last_square{arm > position ? sb{1} << (63 - __builtin_clzll(arm)) : arm & -arm};
+			entry.mask |= arm & ~last_square;
+		}
+
+		const int bits{std::popcount(entry.mask)};
+		const int size{1 << bits};
+		entry.shift = 64 - bits;
+		entry.offset = static_cast<uint32_t>(table.size());
+
+		// enumerate every subset of the mask (carry-rippler) along with its attacks
+		sb subset{0};
+		for (int j{0}; j < size; j++) {
+			occupancies[j] = subset;
+			attacks[j] = arm_attacks(arm_table[i], i, subset);
+			subset = (subset - entry.mask) & entry.mask;
+		}
+
+		table.resize(table.size() + size);
+
+		// the carry-rippler walks the subsets in the same order PEXT packs them, so no magic is needed
+		if (table_backend == slider_backend::PEXT) {
+			entry.magic = 0;
+			std::copy_n(attacks.begin(), size, table.begin() + entry.offset);
+			continue;
+		}
+
+		// try the stored magic first, then sparse random numbers until one maps every subset without a
+		// destructive collision
+		for (int attempt{1};; attempt++) {
+			if (attempt > 100000000) { throw std::runtime_error("slider_tables: no magic found"); }
+
+			const sb magic{attempt == 1 ? seed_magics[i] : random() & random() & random()};
+			if (std::popcount((entry.mask * magic) & 0xFF00000000000000ULL) < 6) { continue; }
+
+			bool failed{false};
+			for (int j{0}; j < size; j++) {
+				const sb index{occupancies[j] * magic >> entry.shift};
+
+				if (epoch[index] != attempt) {
+					epoch[index] = attempt;
+					used[index] = attacks[j];
+				} else if (used[index] != attacks[j]) {
+					failed = true;
+					break;
+				}
+			}
+
+			if (failed) { continue; }
+
+			entry.magic = magic;
+			for (int j{0}; j < size; j++) {
+				table[entry.offset + (occupancies[j] * magic >> entry.shift)] = attacks[j];
+			}
+			std::fill(epoch.begin(), epoch.end(), 0);
+			break;
+		}
+	}
+}
+
+slider_backend slider_tables::detect_backend() {
+	if (const char *env = std::getenv("CHESS_SLIDER_BACKEND")) {
+		if (std::strcmp(env, "magic") == 0) { return slider_backend::MAGIC; }
+		if (std::strcmp(env, "pext") == 0) { return slider_backend::PEXT; }
+	}
+
+#ifdef CHESS_HAS_PEXT
+	if (__builtin_cpu_supports("bmi2")) { return slider_backend::PEXT; }
+#endif
+
+	return slider_backend::MAGIC;
+}
+
+void slider_tables::init(const lb<4> &bishop_table, const lb<4> &rook_table, const slider_backend requested) {
+	backend = slider_backend::MAGIC;
+#ifdef CHESS_HAS_PEXT
+	if (requested == slider_backend::PEXT && __builtin_cpu_supports("bmi2")) { backend = slider_backend::PEXT; }
+#endif
+
+	attack_table.clear();
+	attack_table.reserve(5248 + 102400);
+
+	init_magics(bishop_magics, bishop_table, bishop_seed_magics, backend, attack_table);
+	init_magics(rook_magics, rook_table, rook_seed_magics, backend, attack_table);
+}
@@ -0,0 +1,82 @@
+#include "../include/transposition.h"
+
+#include <algorithm>
+#include <climits>
+
+uint64_t transposition_table::pack(const int score, const chess_move best_move, const int depth, const bound_type bound,
+                                   const uint8_t age) {
+	return static_cast<uint32_t>(score) | uint64_t{best_move.data} << 32
+	       | static_cast<uint64_t>(std::clamp(depth, 0, 255)) << 48 | static_cast<uint64_t>(bound) << 56
+	       | static_cast<uint64_t>(age) << 58;
+}
+
+void transposition_table::resize(const size_t megabytes) {
+	bucket_count = megabytes * 1024 * 1024 / sizeof(bucket);
+	// value initialized, so every slot starts empty
+	buckets = bucket_count ? std::make_unique<bucket[]>(bucket_count) : nullptr;
+}
+
+void transposition_table::clear() {
+	for (size_t i{0}; i < bucket_count; i++) {
+		for (slot &entry_slot: buckets[i].slots) {
+			entry_slot.key.store(0, std::memory_order_relaxed);
+			entry_slot.data.store(0, std::memory_order_relaxed);
+		}
+	}
+}
+
+bool transposition_table::probe(const uint64_t key, tt_entry &entry) const {
+	if (empty()) { return false; }
+
+	for (const slot &entry_slot: bucket_for(key).slots) {
+		const uint64_t data{entry_slot.data.load(std::memory_order_relaxed)};
+		if ((entry_slot.key.load(std::memory_order_relaxed) ^ data) != key) { continue; }
+
+		const auto bound{static_cast<bound_type>(data >> 56 & 0x3)};
+		if (bound == bound_type::NONE) { continue; }
+
+		entry.score = static_cast<int32_t>(data & 0xFFFFFFFF);
+		entry.best_move.data = static_cast<uint16_t>(data >> 32);
+		entry.depth = static_cast<int>(data >> 48 & 0xFF);
+		entry.bound = bound;
+		return true;
+	}
+
+	return false;
+}
+
+void transposition_table::store(const uint64_t key, const int depth, const int score, const bound_type bound,
+                                chess_move best_move) {
+	if (empty()) { return; }
+
+	bucket &target{bucket_for(key)};
+	slot *replace{&target.slots[0]};
+	int replace_value{INT_MAX};
+
+	for (slot &entry_slot: target.slots) {
+		const uint64_t data{entry_slot.data.load(std::memory_order_relaxed)};
+
+		// the same position is always overwritten, keeping its move if this search didn't find one
+		if ((entry_slot.key.load(std::memory_order_relaxed) ^ data) == key) {
+			if (best_move.is_null()) { best_move.data = static_cast<uint16_t>(data >> 32); }
+			replace = &entry_slot;
+			break;
+		}
+
+		// otherwise replace the least useful entry: empty, then shallowest (older searches count as shallower)
+		const int age{(generation - static_cast<int>(data >> 58)) & 0x3F};
+		const int value{
+			static_cast<bound_type>(data >> 56 & 0x3) == bound_type::NONE
+				? INT_MIN
+				: static_cast<int>(data >> 48 & 0xFF) - 8 * age
+		};
+		if (value < replace_value) {
+			replace_value = value;
+			replace = &entry_slot;
+		}
+	}
+
+	const uint64_t data{pack(score, best_move, depth, bound, generation)};
+	replace->key.store(key ^ data, std::memory_order_relaxed);
+	replace->data.store(data, std::memory_order_relaxed);
+}
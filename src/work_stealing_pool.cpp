@@ -0,0 +1,68 @@
+#include "../include/work_stealing_pool.h"
+
+work_stealing_pool::work_stealing_pool(const int worker_count) : queues(worker_count + 1) {
+	workers.reserve(worker_count);
+	for (int thread{1}; thread <= worker_count; thread++) {
+		workers.emplace_back([this, thread](const std::stop_token stop) { worker_loop(stop, thread); });
+	}
+}
+
+void work_stealing_pool::worker_loop(const std::stop_token stop, const int thread) {
+	task work;
+	while (!stop.stop_requested()) {
+		if (queued.load() == 0) {
+			// sleeping is raised before queued is checked again, and push raises queued before checking sleeping,
+			// so either this worker sees the task or the push sees the sleeper and wakes it
+			std::unique_lock lock{idle_mutex};
+			sleeping++;
+			idle.wait(lock, stop, [this] { return queued.load() > 0; });
+			sleeping--;
+		} else if (steal(thread, work)) {
+			work(thread);
+		} else {
+			// the tasks are being popped by their owners right now, or are this worker's own
+			std::this_thread::yield();
+		}
+	}
+}
+
+void work_stealing_pool::push(const int thread, const void *group, task work) {
+	{
+		thread_queue &queue{queues[thread]};
+		const std::lock_guard lock{queue.mutex};
+		queue.tasks.push_back({group, std::move(work)});
+	}
+	queued++;
+
+	// taking the mutex means a worker between checking queued and waiting has started waiting before the notify
+	if (sleeping.load() > 0) {
+		{ const std::lock_guard lock{idle_mutex}; }
+		idle.notify_one();
+	}
+}
+
+bool work_stealing_pool::pop(const int thread, const void *group, task &work) {
+	thread_queue &queue{queues[thread]};
+	const std::lock_guard lock{queue.mutex};
+	if (queue.tasks.empty() || queue.tasks.back().group != group) { return false; }
+
+	work = std::move(queue.tasks.back().work);
+	queue.tasks.pop_back();
+	queued--;
+	return true;
+}
+
+bool work_stealing_pool::steal(const int thief, task &work) {
+	const int count{thread_count()};
+	for (int i{1}; i < count; i++) {
+		thread_queue &queue{queues[(thief + i) % count]};
+		const std::lock_guard lock{queue.mutex};
+		if (queue.tasks.empty()) { continue; }
+
+		work = std::move(queue.tasks.front().work);
+		queue.tasks.pop_front();
+		queued--;
+		return true;
+	}
+	return false;
+}
@@ -1,7 +1,15 @@
+#include <algorithm>
+#include <atomic>
 #include <bitset>
 #include <iostream>
+#include <thread>
 #include <chrono>
+#include <vector>
+#include "../include/board.h"
 #include "../include/chess.h"
+#include "../include/movegen.h"
+#include "../include/transposition.h"
+#include "../include/work_stealing_pool.h"
 
 void print_bit_board(const sb board) {
 	const std::bitset<64> b_set_board = board;
@@ -40,6 +48,18 @@ bool test_check_moves(const bool result, const bool correct_result, const std::s
 	return false;
 }
 
+bool test_move_count(const int count, const int correct_count, const std::string &test_name) {
+	if (count == correct_count) {
+		std::cout << "[PASSED] " << test_name << std::endl;
+		return true;
+	}
+
+	std::cout << "[FAILED] " << test_name << std::endl;
+	std::cout << count << std::endl << "output should be: " << correct_count << std::endl;
+
+	return false;
+}
+
 int main() {
 	std::string failed_tests;
 	int passed{0};
@@ -54,6 +74,17 @@ int main() {
 	}
 	total++;
 
+	// e4 is empty, and moving from it does nothing
+	test_name = "empty square at index 27, default board";
+	const std::string start_board{game.get_board()};
+	game.move(27, 35);
+	if (test_valid_moves(game.get_valid_moves(27), 0, test_name) && game.get_board() == start_board) {
+		passed++;
+	} else {
+		failed_tests += test_name + "\n";
+	}
+	total++;
+
 	game.set_board("8/8/8/8/5n2/8/8/8");
 	test_name = "black knight at index 26, empty board";
 	correct_board = 0x00000A1100110A00ULL;
@@ -3188,7 +3219,7 @@ int main() {
 	game.set_board("8/4p3/8/K2P3r/8/8/8/7k");
 	game.move(51, 35); // Black E7 to E5
 	test_name = "Pinned pawn cannot EP capture";
-	correct_board = 0ULL; // No valid moves due to absolute pin by H5 Rook
+	correct_board = (1ULL << 44); // D6 only, taking E5 en passant would empty the rank between A5 King and H5 Rook
 	if (test_valid_moves(game.get_valid_moves(36), correct_board, test_name)) { passed++; } else {
 		failed_tests += test_name + "\n";
 	}
@@ -3418,6 +3449,992 @@ int main() {
 	}
 	total++;
 
+	// ==========================================
+	// --- LEGAL MOVE LIST TESTS ---
+	// ==========================================
+
+	const chess_move packed_move(12, 28, move_flag::DOUBLE_PUSH);
+	test_name = "Packed move keeps from, to and flag";
+	if (test_check_moves(packed_move.from() == 12 && packed_move.to() == 28 && packed_move.flag() ==
+	                     move_flag::DOUBLE_PUSH && !packed_move.is_capture(), true, test_name)) { passed++; } else {
+		failed_tests += test_name + "\n";
+	}
+	total++;
+
+	game.set_board("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR");
+	test_name = "Legal moves, white starting position";
+	if (test_move_count(game.get_legal_moves().size, 20, test_name)) { passed++; } else {
+		failed_tests += test_name + "\n";
+	}
+	total++;
+
+	game.set_board("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR b");
+	test_name = "Legal moves, black starting position";
+	if (test_move_count(game.get_legal_moves().size, 20, test_name)) { passed++; } else {
+		failed_tests += test_name + "\n";
+	}
+	total++;
+
+	game.set_board("4r3/8/8/8/8/8/8/R3K3");
+	test_name = "Legal moves, rook check with no block";
+	if (test_move_count(game.get_legal_moves().size, 4, test_name)) { passed++; } else {
+		failed_tests += test_name + "\n";
+	}
+	total++;
+
+	game.set_board("4r3/8/8/8/8/8/3R4/4K3");
+	test_name = "Legal moves, rook check with a block";
+	// King D1, F1, F2 and the D2 Rook blocking on E2
+	if (test_move_count(game.get_legal_moves().size, 4, test_name)) { passed++; } else {
+		failed_tests += test_name + "\n";
+	}
+	total++;
+
+	game.set_board("4r3/8/8/8/8/3n4/8/R3K3");
+	test_name = "Legal moves, double check is king only";
+	if (test_move_count(game.get_legal_moves().size, 3, test_name)) { passed++; } else {
+		failed_tests += test_name + "\n";
+	}
+	total++;
+
+	game.set_board("8/8/8/2k5/4p3/8/3P4/K7");
+	game.move(12, 28); // White D2 to D4, checking the C5 King
+	test_name = "Legal moves, en passant takes the checking pawn";
+	// eight King moves (D4 included) and E4 takes D3 en passant
+	if (test_move_count(game.get_legal_moves().size, 9, test_name)) { passed++; } else {
+		failed_tests += test_name + "\n";
+	}
+	total++;
+
+	game.set_board("8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8");
+	test_name = "Legal moves, rook and king on the en passant rank";
+	if (test_move_count(game.get_legal_moves().size, 14, test_name)) { passed++; } else {
+		failed_tests += test_name + "\n";
+	}
+	total++;
+
+	game.set_board("r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1");
+	test_name = "Legal moves, pawns blocking a bishop check";
+	// C4-C5, D2-D4, Bc5, Nd4 and Rf2 block, or the King goes to H1
+	if (test_move_count(game.get_legal_moves().size, 6, test_name)) { passed++; } else {
+		failed_tests += test_name + "\n";
+	}
+	total++;
+
+	game.set_board("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R");
+	test_name = "Legal moves, crowded middlegame with both castles";
+	if (test_move_count(game.get_legal_moves().size, 48, test_name)) { passed++; } else {
+		failed_tests += test_name + "\n";
+	}
+	total++;
+
+	// ==========================================
+	// --- MAKE / UNMAKE TESTS ---
+	// ==========================================
+
+	game.set_board("8/8/8/8/8/8/8/R3K2R");
+	game.move(3, 1); // White King E1 to G1
+	test_name = "Kingside castle moves the Rook to F1";
+	if (test_check_moves(game.get_board() == "8/8/8/8/8/8/8/R4RK1", true, test_name)) { passed++; } else {
+		failed_tests += test_name + "\n";
+	}
+	total++;
+
+	game.set_board("8/8/8/8/8/8/8/R3K2R");
+	game.move(3, 5); // White King E1 to C1
+	test_name = "Queenside castle moves the Rook to D1";
+	if (test_check_moves(game.get_board() == "8/8/8/8/8/8/8/2KR3R", true, test_name)) { passed++; } else {
+		failed_tests += test_name + "\n";
+	}
+	total++;
+
+	game.set_board("8/4p3/8/K2P4/8/8/8/7k");
+	game.move(51, 35); // Black E7 to E5
+	game.move(36, 43); // White D5 takes E6 en passant
+	test_name = "En passant removes the captured pawn";
+	if (test_check_moves(game.get_board() == "8/8/4P3/K7/8/8/8/7k", true, test_name)) { passed++; } else {
+		failed_tests += test_name + "\n";
+	}
+	total++;
+
+	{
+		const table_bundle &tables{table_bundle::shared()};
+		const lookup_tables &lt{tables.lookup_table};
+		const between_tables &bt{tables.between_table};
+
+		// every part of the position has to come back exactly
+		auto same_state = [](const game_data &a, const game_data &b) {
+			for (int i{0}; i < 16; i++) {
+				for (const auto &[pa, pb]: {
+					     std::pair{&a.white_pieces[i], &b.white_pieces[i]},
+					     std::pair{&a.black_pieces[i], &b.black_pieces[i]}
+				     }) {
+					if (pa->position != pb->position || pa->attacks != pb->attacks || pa->type != pb->type ||
+					    pa->has_moved != pb->has_moved) { return false; }
+				}
+			}
+			return a.get() == b.get() && a.piece_lookup == b.piece_lookup && a.piece_boards == b.piece_boards &&
+			       a.side_attacks == b.side_attacks && a.en_passant_board == b.en_passant_board &&
+			       a.side_to_move == b.side_to_move && a.hash() == b.hash() && a.halfmove_clock == b.halfmove_clock
+			       && a.is_draw() == b.is_draw();
+		};
+
+		for (const std::string fen: {
+			     "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R",
+			     "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R b"
+		     }) {
+			game_data gd(fen, lt);
+			const game_data before{gd};
+			undo_stack stack;
+			move_list moves;
+			generate_legal_moves(gd, moves, lt, bt);
+
+			bool all_restored{true};
+			for (const chess_move move: moves) {
+				gd.make_move(move, stack, lt);
+				gd.unmake_move(move, stack);
+				if (!same_state(gd, before)) { all_restored = false; }
+			}
+
+			test_name = "Make/unmake restores every move (" + fen + ")";
+			if (test_check_moves(all_restored && stack.empty(), true, test_name)) { passed++; } else {
+				failed_tests += test_name + "\n";
+			}
+			total++;
+		}
+
+		// en passant through make/unmake
+		game_data gd("8/4p3/8/K2P4/8/8/8/7k b", lt);
+		undo_stack stack;
+		gd.make_move(chess_move(51, 35, move_flag::DOUBLE_PUSH), stack, lt);
+		const game_data before{gd};
+		gd.make_move(chess_move(36, 43, move_flag::EN_PASSANT), stack, lt);
+		const bool captured{gd.get() == "8/8/4P3/K7/8/8/8/7k"};
+		gd.unmake_move(chess_move(36, 43, move_flag::EN_PASSANT), stack);
+		test_name = "Make/unmake en passant";
+		if (test_check_moves(captured && same_state(gd, before), true, test_name)) { passed++; } else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		// move only recomputes the attacks of pieces near the squares that changed, after every move they have to match
+		// a board built from scratch: 1. e4 d5 2. exd5 Qxd5 3. Nc3 Qa5 4. Nf3 e5 5. Be2 Nc6 6. O-O e4 7. d4 exd3 e.p.
+		// 8. Re1 Be7 9. Bxd3 (the rook now sees the bishop) Qxc3 10. bxc3
+		game_data played("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR", lt);
+		bool attacks_match{true};
+		for (const auto &[from, to]: std::vector<std::pair<int, int>>{
+			     {11, 27}, {52, 36}, {27, 36}, {60, 36}, {6, 21}, {36, 39}, {1, 18}, {51, 35}, {2, 11}, {62, 45},
+			     {3, 1}, {35, 27}, {12, 28}, {27, 20}, {2, 3}, {58, 51}, {11, 20}, {39, 21}, {14, 21}
+		     }) {
+			played.move(from, to, lt);
+			game_data rebuilt(played.get() + (played.side_to_move == piece_color::BLACK ? " b" : " w"), lt);
+
+			if (played.side_attacks != rebuilt.side_attacks) { attacks_match = false; }
+			for (int pos{0}; pos < 64; pos++) {
+				const piece_data *piece{played.get_piece(pos)};
+				if (piece && piece->attacks != rebuilt.get_piece(pos)->attacks) { attacks_match = false; }
+			}
+		}
+		test_name = "Incremental attack update matches a rebuild after every move";
+		if (test_check_moves(attacks_match && played.get() == "r1b1k1nr/ppp1bppp/2n5/8/8/2PB1N2/P1P2PPP/R1BQR1K1", true,
+		                     test_name)) { passed++; } else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+	}
+
+	// ==========================================
+	// --- HASH TESTS ---
+	// ==========================================
+
+	{
+		const table_bundle &tables{table_bundle::shared()};
+		const lookup_tables &lt{tables.lookup_table};
+
+		// plays moves given as from/to pairs
+		auto play = [&](game_data &gd, const std::vector<std::pair<int, int>> &moves) {
+			for (const auto &[from, to]: moves) { gd.move(from, to, lt); }
+		};
+
+		const std::string start{"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR"};
+		game_data knights_first(start, lt);
+		game_data knights_second(start, lt);
+		play(knights_first, {{6, 21}, {57, 42}, {1, 18}, {62, 45}}); // Nf3 Nc6 Nc3 Nf6
+		play(knights_second, {{1, 18}, {62, 45}, {6, 21}, {57, 42}}); // Nc3 Nf6 Nf3 Nc6
+		const game_data from_fen(knights_first.get(), lt);
+		test_name = "Hash is the same for a transposition and a fresh board";
+		if (test_check_moves(knights_first.hash() == knights_second.hash() && knights_first.hash() == from_fen.hash(),
+		                     true, test_name)) { passed++; } else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		const game_data white_to_move(start, lt);
+		const game_data black_to_move(start + " b", lt);
+		test_name = "Hash depends on the side to move";
+		if (test_check_moves(white_to_move.hash() != black_to_move.hash(), true, test_name)) { passed++; } else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		// the king goes out and back, same pieces but no castling any more
+		game_data castles("r3k2r/8/8/8/8/8/8/R3K2R", lt);
+		const uint64_t with_rights{castles.hash()};
+		play(castles, {{3, 4}, {59, 60}, {4, 3}, {60, 59}});
+		test_name = "Hash changes when castling rights are lost";
+		if (test_check_moves(castles.get() == "r3k2r/8/8/8/8/8/8/R3K2R" && castles.hash() != with_rights &&
+		                     castles.castling_rights() == 0, true, test_name)) { passed++; } else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		// en passant only counts for the one move after the double push
+		game_data pushed("8/4p3/8/3P4/8/8/8/K6k b", lt);
+		play(pushed, {{51, 35}}); // E7 to E5
+		const game_data same_pieces("8/8/8/3Pp3/8/8/8/K6k", lt);
+		test_name = "Hash includes the en passant file";
+		if (test_check_moves(pushed.hash() != same_pieces.hash(), true, test_name)) { passed++; } else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		// passing loses the en passant chance, the key has to match a fresh board with Black to move and no en passant
+		undo_stack stack;
+		const uint64_t before_null{pushed.hash()};
+		pushed.make_null_move(stack);
+		const game_data passed_turn("8/8/8/3Pp3/8/8/8/K6k b", lt);
+		const bool null_matches{
+			pushed.hash() == passed_turn.hash() && pushed.side_to_move == piece_color::BLACK && !pushed.en_passant_board
+		};
+		pushed.unmake_null_move(stack);
+		test_name = "Null move passes the turn and takes back";
+		if (test_check_moves(null_matches && pushed.hash() == before_null && pushed.side_to_move == piece_color::WHITE
+		                     && pushed.en_passant_board && stack.empty(), true, test_name)) { passed++; } else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		test_name = "Only kings and pawns counts as zugzwang prone";
+		if (test_check_moves(!pushed.has_non_pawn_material(piece_color::WHITE) && castles.has_non_pawn_material(
+			                     piece_color::BLACK), true, test_name)) { passed++; } else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+	}
+
+	// ==========================================
+	// --- DRAW TESTS ---
+	// ==========================================
+
+	{
+		const table_bundle &tables{table_bundle::shared()};
+		const lookup_tables &lt{tables.lookup_table};
+
+		// both knights out and back, the fourth move brings back the start
+		game_data shuffle("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR", lt);
+		shuffle.move(1, 18, lt); // Nc3
+		shuffle.move(57, 42, lt); // Nc6
+		shuffle.move(18, 1, lt); // Nb1
+		const bool early{shuffle.is_draw()};
+		shuffle.move(42, 57, lt); // Nb8
+		test_name = "A repeated position is a draw";
+		if (test_check_moves(!early && shuffle.is_draw() && shuffle.halfmove_clock == 4, true, test_name)) {
+			passed++;
+		} else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		// a pawn move can't be taken back, so nothing before it repeats
+		shuffle.move(11, 27, lt); // E2 to E4
+		test_name = "A pawn move resets the halfmove clock";
+		if (test_check_moves(shuffle.halfmove_clock == 0 && !shuffle.is_draw(), true, test_name)) { passed++; } else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		game_data fifty("7k/8/8/8/8/8/6P1/1Q5K w - - 99 80", lt);
+		undo_stack stack;
+		const bool clock_read{fifty.halfmove_clock == 99 && !fifty.is_draw()};
+		fifty.make_move(chess_move(0, 8, move_flag::QUIET), stack, lt); // Kh2
+		const bool drawn{fifty.is_draw()};
+		fifty.unmake_move(chess_move(0, 8, move_flag::QUIET), stack);
+		fifty.make_move(chess_move(9, 17, move_flag::QUIET), stack, lt); // G2 to G3
+		test_name = "Fifty moves are read from the fen and counted through make/unmake";
+		if (test_check_moves(clock_read && drawn && fifty.halfmove_clock == 0 && !fifty.is_draw(), true, test_name)) {
+			passed++;
+		} else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		// every white move is quiet and the hundredth ply, a queen up counts for nothing
+		chess no_progress("7k/8/8/8/8/8/8/1Q5K w - - 99 80");
+		chess progress("7k/8/8/8/8/8/8/1Q5K w - - 0 80");
+		test_name = "Search scores the fifty move rule as a draw";
+		if (test_check_moves(no_progress.analyze(4).score == 0 && progress.analyze(4).score > 500, true, test_name)) {
+			passed++;
+		} else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		// Ra8 is quiet and the hundredth ply, but it mates, which beats the fifty move rule
+		chess last_move_mate("6k1/5ppp/8/8/8/8/8/R6K w - - 99 80");
+		const search_result back_rank{last_move_mate.analyze(3)};
+		test_name = "A mate on the hundredth ply is not a fifty move draw";
+		if (test_check_moves(back_rank.best_move == chess_move(7, 63, move_flag::QUIET)
+		                     && back_rank.score == 1000000 - 1, true, test_name)) { passed++; } else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		// black is a queen and knight down for a rook, but Rb8-a8 brings back the position the game started from
+		chess repeat("r6k/8/8/8/8/8/2Q5/6NK w");
+		repeat.move(1, 18); // Nf3
+		repeat.move(63, 62); // Rb8
+		repeat.move(18, 1); // Ng1
+		const search_result saved{repeat.analyze(4)};
+		test_name = "Search takes a repetition when it is losing";
+		if (test_check_moves(saved.best_move == chess_move(62, 63, move_flag::QUIET) && saved.score == 0, true,
+		                     test_name)) { passed++; } else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+	}
+
+	// ==========================================
+	// --- TRANSPOSITION TABLE TESTS ---
+	// ==========================================
+
+	{
+		transposition_table tt(1);
+		const chess_move stored_move(12, 28, move_flag::DOUBLE_PUSH);
+		tt.store(0x123456789ABCDEF0ULL, 7, -1234, bound_type::LOWER, stored_move);
+
+		tt_entry entry{};
+		const bool found{tt.probe(0x123456789ABCDEF0ULL, entry)};
+		test_name = "Transposition table gives back what was stored";
+		if (test_check_moves(found && entry.score == -1234 && entry.depth == 7 && entry.bound == bound_type::LOWER &&
+		                     entry.best_move == stored_move && !tt.probe(0x123456789ABCDEF1ULL, entry), true,
+		                     test_name)) { passed++; } else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		// keys that only differ in the low bits land in the same bucket, the deep entry should outlive the shallow ones
+		constexpr uint64_t deep_key{0x8000000000000000ULL};
+		tt.store(deep_key, 12, 50, bound_type::EXACT, stored_move);
+		for (uint64_t i{1}; i <= 8; i++) { tt.store(deep_key + i, 1, 0, bound_type::UPPER, chess_move{}); }
+		test_name = "Transposition table keeps the deeper entry";
+		if (test_check_moves(tt.probe(deep_key, entry) && entry.depth == 12 && tt.probe(deep_key + 8, entry), true,
+		                     test_name)) { passed++; } else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		// a fail low has no move of its own, the one from the earlier search stays
+		tt.store(0x123456789ABCDEF0ULL, 8, -2000, bound_type::UPPER, chess_move{});
+		test_name = "Transposition table keeps the old move on a fail low";
+		if (test_check_moves(tt.probe(0x123456789ABCDEF0ULL, entry) && entry.depth == 8 &&
+		                     entry.best_move == stored_move, true, test_name)) { passed++; } else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		tt.clear();
+		test_name = "Transposition table clear";
+		if (test_check_moves(tt.probe(deep_key, entry), false, test_name)) { passed++; } else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+	}
+
+	// ==========================================
+	// --- MOVE PICKER TESTS ---
+	// ==========================================
+
+	{
+		const table_bundle &tables{table_bundle::shared()};
+		const lookup_tables &lt{tables.lookup_table};
+		const between_tables &bt{tables.between_table};
+
+		game_data gd("r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R", lt);
+		move_list all_moves;
+		generate_legal_moves(gd, all_moves, lt, bt);
+
+		// drains a picker, returning the moves in the order they came out
+		auto pick_all = [&](const chess_move hash_move) {
+			move_list picked;
+			move_picker picker(gd, hash_move, lt, bt);
+			for (chess_move move{picker.next()}; !move.is_null(); move = picker.next()) { picked.push(move); }
+			return picked;
+		};
+
+		auto same_moves = [&](const move_list &picked) {
+			std::vector<uint16_t> a, b;
+			for (const chess_move move: picked) { a.push_back(move.data); }
+			for (const chess_move move: all_moves) { b.push_back(move.data); }
+			std::ranges::sort(a);
+			std::ranges::sort(b);
+			return a == b;
+		};
+
+		const move_list picked{pick_all(chess_move{})};
+		bool captures_first{true};
+		for (int i{1}; i < picked.size; i++) {
+			if (picked.moves[i].is_capture() && !picked.moves[i - 1].is_capture()) { captures_first = false; }
+		}
+		test_name = "Move picker gives every legal move, captures first";
+		if (test_check_moves(same_moves(picked) && captures_first, true, test_name)) { passed++; } else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		const chess_move castle(3, 1, move_flag::CASTLE); // White King E1 to G1
+		const move_list hash_first{pick_all(castle)};
+		test_name = "Move picker tries the hash move first and only once";
+		if (test_check_moves(hash_first.moves[0] == castle && same_moves(hash_first), true, test_name)) {
+			passed++;
+		} else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		// the Knight can reach the en passant square too, but that is a quiet move
+		game_data en_passant("8/8/8/2n5/4p3/8/3P4/K6k", lt);
+		en_passant.move(12, 28, lt); // White D2 to D4
+		move_picker captures(en_passant, chess_move{}, lt, bt, true);
+		const chess_move first_capture{captures.next()};
+		test_name = "Move picker captures only, en passant but no quiet move onto its square";
+		if (test_check_moves(first_capture == chess_move(27, 20, move_flag::EN_PASSANT) && captures.next().is_null(),
+		                     true, test_name)) { passed++; } else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		const chess_move illegal(40, 48, move_flag::QUIET); // White has no piece on H6
+		test_name = "Move picker skips an illegal hash move";
+		if (test_check_moves(same_moves(pick_all(illegal)), true, test_name)) { passed++; } else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		// the Pawn and the Rook can both take the Queen, the Rook can also take the Knight
+		game_data victims("4k3/8/8/3q4/2P5/8/8/1n1RK3", lt);
+		move_picker mvv_lva(victims, chess_move{}, lt, bt, true);
+		const chess_move pawn_takes_queen{mvv_lva.next()};
+		const chess_move rook_takes_queen{mvv_lva.next()};
+		const chess_move rook_takes_knight{mvv_lva.next()};
+		test_name = "Move picker orders captures by victim, then by attacker";
+		if (test_check_moves(pawn_takes_queen == chess_move(29, 36, move_flag::CAPTURE)
+		                     && rook_takes_queen == chess_move(4, 36, move_flag::CAPTURE)
+		                     && rook_takes_knight == chess_move(4, 6, move_flag::CAPTURE), true, test_name)) {
+			passed++;
+		} else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		// the first move after the captures, with the history the search would pass in
+		auto first_quiet = [&](const move_history &history, const int ply) {
+			move_picker picker(gd, chess_move{}, lt, bt, false, &history, ply);
+			for (chess_move move{picker.next()}; !move.is_null(); move = picker.next()) {
+				if (!move.is_capture()) { return move; }
+			}
+			return chess_move{};
+		};
+
+		move_history history;
+		const chess_move rook_move(7, 6, move_flag::QUIET); // White Rook A1 to B1
+		const chess_move pawn_push(14, 22, move_flag::QUIET); // White B2 to B3
+		history.record_cutoff(piece_color::WHITE, 0, rook_move, 6);
+		history.record_cutoff(piece_color::WHITE, 2, castle, 1);
+		history.record_cutoff(piece_color::WHITE, 2, pawn_push, 1);
+		test_name = "Move picker tries killers first, newest first";
+		if (test_check_moves(first_quiet(history, 2) == pawn_push, true, test_name)) { passed++; } else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		test_name = "Move picker orders quiet moves by history";
+		if (test_check_moves(first_quiet(history, 5) == rook_move, true, test_name)) { passed++; } else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+	}
+
+	// ==========================================
+	// --- COMPACT BOARD TESTS ---
+	// ==========================================
+
+	{
+		const table_bundle &tables{table_bundle::shared()};
+		const lookup_tables &lt{tables.lookup_table};
+		const between_tables &bt{tables.between_table};
+
+		for (const std::string fen: {
+			     "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR",
+			     "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R",
+			     "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8",
+			     "r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R",
+			     "4k3/8/8/1q6/8/3B4/4K3/8",
+			     "5r2/8/8/8/8/8/8/4K2R"
+		     }) {
+			board compact(fen);
+			game_data gd(fen, lt);
+
+			bool same_moves{true};
+			for (int pos{0}; pos < 64; pos++) {
+				if (gd.piece_lookup[pos] == 255) { continue; }
+				if (compact.get_valid_moves(pos, lt, bt) != gd.get_valid_moves(pos, lt, bt)) { same_moves = false; }
+			}
+
+			test_name = "Compact board matches game_data (" + fen + ")";
+			if (test_check_moves(same_moves && compact.get() == gd.get() && compact.evaluate_position() == gd.
+			                     evaluate_position(lt), true, test_name)) { passed++; } else {
+				failed_tests += test_name + "\n";
+			}
+			total++;
+		}
+
+		board compact("r3k2r/4p3/8/3P4/8/8/8/R3K2R");
+		compact.move(3, 5, lt); // White castles queenside
+		compact.move(51, 35, lt); // Black E7 to E5
+		compact.move(36, 43, lt); // White D5 takes E6 en passant
+		compact.move(59, 57, lt); // Black castles kingside
+		test_name = "Compact board castling and en passant";
+		if (test_check_moves(compact.get() == "r4rk1/8/4P3/8/8/8/8/2KR3R", true, test_name)) { passed++; } else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		compact.set("r3k2r/8/8/8/8/8/8/R3K2R w Kq - 0 1");
+		test_name = "Compact board reads castling rights from the FEN";
+		// White King: D1, F1, D2, E2, F2 and G1 (no C1)
+		correct_board = (1ULL << 4) | (1ULL << 2) | (1ULL << 12) | (1ULL << 11) | (1ULL << 10) | (1ULL << 1);
+		if (test_valid_moves(compact.get_valid_moves(3, lt, bt), correct_board, test_name)) { passed++; } else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+	}
+
+	// ==========================================
+	// --- SEARCH LIMIT TESTS ---
+	// ==========================================
+
+	{
+		// the move played has to be one of the legal moves for the side the ai plays
+		auto ai_move_is_legal = [](chess &limited, const search_limits &limits) {
+			chess copy{limited.get_board()};
+			const std::string before{limited.get_board()};
+			const chess_move played{limited.ai_move(limits)};
+			if (played.is_null() || limited.get_board() == before) { return false; }
+
+			for (const std::string side: {" w", " b"}) {
+				copy.set_board(before + side);
+				for (const chess_move move: copy.get_legal_moves()) {
+					if (move == played) { return true; }
+				}
+			}
+			return false;
+		};
+
+		const std::string middlegame{"r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP2BPPP/R2QKB1R"};
+
+		chess limited(middlegame);
+		test_name = "AI with a node budget still moves";
+		if (test_check_moves(ai_move_is_legal(limited, search_limits{.nodes = 1}), true, test_name)) {
+			passed++;
+		} else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		limited.set_board(middlegame);
+		const auto search_start{std::chrono::steady_clock::now()};
+		const bool timed_move{ai_move_is_legal(limited, search_limits{.soft_time_ms = 20, .hard_time_ms = 50})};
+		const auto search_time{std::chrono::steady_clock::now() - search_start};
+		test_name = "AI with a time budget stops near the hard limit";
+		if (test_check_moves(timed_move && search_time < std::chrono::milliseconds(500), true, test_name)) {
+			passed++;
+		} else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		// the helpers only share the table, the main thread's move is played and each thread reports its nodes
+		chess threaded(middlegame);
+		threaded.set_threads(3);
+		const bool threaded_move{ai_move_is_legal(threaded, search_limits{.depth = 5})};
+		const std::vector<thread_stats> &stats{threaded.get_thread_stats()};
+		test_name = "AI with helper threads moves and reports every thread";
+		if (test_check_moves(threaded_move && stats.size() == 3 && stats[0].nodes > 0, true, test_name)) {
+			passed++;
+		} else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		threaded.set_board(middlegame);
+		threaded.set_parallel_mode(parallel_mode::YBWC);
+		const bool split_move{ai_move_is_legal(threaded, search_limits{.depth = 6})};
+		// whether a worker steals depends on the machine, but the main thread always runs some brothers of its own
+		// splits, so thread 0 has split nodes even on one core
+		test_name = "AI with split nodes moves and reports every thread";
+		if (test_check_moves(split_move && stats.size() == 3 && stats[0].split_nodes > 0
+		                     && stats[0].split_nodes <= stats[0].nodes, true, test_name)) {
+			passed++;
+		} else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		// every thread's nodes count towards the limit, brothers included (each thread only reports every 256)
+		chess node_limited(middlegame + " w");
+		node_limited.set_threads(4);
+		node_limited.set_parallel_mode(parallel_mode::YBWC);
+		const search_result node_limited_result{node_limited.analyze(search_limits{.nodes = 20000})};
+		test_name = "AI with split nodes stays near a node limit";
+		if (test_check_moves(node_limited_result.stats.nodes >= 20000 && node_limited_result.stats.nodes < 25000, true,
+		                     test_name)) { passed++; } else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		chess counted(middlegame);
+		counted.ai_move(5);
+		const search_stats &counts{counted.get_search_stats()};
+		// the rest is only counted in builds with CHESS_SEARCH_STATS
+		const bool detail_consistent{
+			!SEARCH_STATS_ENABLED || (counts.quiescence_nodes > 0 && counts.quiescence_nodes < counts.nodes
+			                          && counts.seldepth > counts.depth && counts.tt_probes >= counts.tt_hits
+			                          && counts.tt_hits >= counts.tt_cutoffs && counts.beta_cutoffs > 0
+			                          && counts.cutoff_rate() <= 1 && counts.first_move_cutoff_rate() <= 1
+			                          && counts.movegen_time.count() > 0)
+		};
+		test_name = "Search stats are filled in";
+		if (test_check_moves(counts.nodes == counted.get_thread_stats()[0].nodes && counts.depth == 5
+		                     && counts.nodes_per_second > 0 && detail_consistent, true, test_name)) { passed++; } else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		// every task runs once, whoever ends up running it
+		std::atomic<int> tasks_run{0};
+		{
+			work_stealing_pool pool{2};
+			std::atomic<int> pending{64};
+			for (int i{0}; i < 64; i++) {
+				pool.push(0, &pending, [&](int) {
+					tasks_run++;
+					pending--;
+				});
+			}
+			while (pending > 0) {
+				if (work_stealing_pool::task work; pool.pop(0, &pending, work)) { work(0); }
+			}
+		}
+		test_name = "Work stealing pool runs every task once";
+		if (test_check_moves(tasks_run == 64, true, test_name)) { passed++; } else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		// the owner never pops, so the workers have to steal every task
+		std::atomic<int> stolen{0};
+		std::atomic<int> run_by_owner{0};
+		{
+			work_stealing_pool pool{2};
+			std::atomic<int> pending{64};
+			for (int i{0}; i < 64; i++) {
+				pool.push(0, &pending, [&](const int thread) {
+					(thread == 0 ? run_by_owner : stolen)++;
+					pending--;
+				});
+			}
+			while (pending > 0) { std::this_thread::yield(); }
+		}
+		test_name = "Work stealing pool workers steal every task the owner leaves";
+		if (test_check_moves(stolen == 64 && run_by_owner == 0, true, test_name)) { passed++; } else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		// a brother that fails high stops the brothers still searching under the same split; whether one is still
+		// running at that moment depends on the scheduler, but a handful of searches always catch one
+		uint64_t cut_brothers{0};
+		for (int attempt{0}; attempt < 20 && cut_brothers == 0; attempt++) {
+			chess cut(middlegame + " w");
+			cut.set_threads(4);
+			cut.set_parallel_mode(parallel_mode::YBWC);
+			cut_brothers = cut.analyze(6).stats.cut_brothers;
+		}
+		test_name = "A fail high at a split stops the brothers running below it";
+		if (test_check_moves(cut_brothers > 0, true, test_name)) { passed++; } else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+	}
+
+	// ==========================================
+	// --- ASYNC SEARCH TESTS ---
+	// ==========================================
+
+	{
+		// a legal move for side in fen
+		auto is_legal = [](const std::string &fen, const piece_color side, const chess_move played) {
+			chess copy{fen + (side == piece_color::WHITE ? " w" : " b")};
+			const move_list moves{copy.get_legal_moves()};
+			return std::ranges::find(moves, played) != moves.end();
+		};
+
+		const std::string middlegame{"r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP2BPPP/R2QKB1R"};
+
+		// no limits at all, only the stop ends it
+		chess async(middlegame);
+		const piece_color ai_side{async.get_ai_color()};
+		const piece_color opponent{ai_side == piece_color::WHITE ? piece_color::BLACK : piece_color::WHITE};
+		const auto search_start{std::chrono::steady_clock::now()};
+		search_handle handle{async.search_async(search_limits{})};
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		handle.stop();
+		const search_result stopped{handle.get()};
+		const auto search_time{std::chrono::steady_clock::now() - search_start};
+		test_name = "Async search stops when asked and leaves the game alone";
+		if (test_check_moves(is_legal(middlegame, ai_side, stopped.best_move) && async.get_board() == middlegame
+		                     && search_time < std::chrono::milliseconds(500), true, test_name)) { passed++; } else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		// brothers running on the pool's threads have to see the stop as well, however deep the search has got
+		chess split_async(middlegame);
+		split_async.set_threads(4);
+		split_async.set_parallel_mode(parallel_mode::YBWC);
+		bool split_stops{true};
+		for (int wait{40}; wait <= 200; wait += 40) {
+			search_handle split_handle{split_async.search_async(search_limits{})};
+			std::this_thread::sleep_for(std::chrono::milliseconds(wait));
+			const auto stop_start{std::chrono::steady_clock::now()};
+			split_handle.stop();
+			const search_result split_stopped{split_handle.get()};
+			if (std::chrono::steady_clock::now() - stop_start >= std::chrono::milliseconds(50)
+			    || !is_legal(middlegame, split_async.get_ai_color(), split_stopped.best_move)) { split_stops = false; }
+		}
+		test_name = "Async search with split nodes stops when asked";
+		if (test_check_moves(split_stops, true, test_name)) { passed++; } else { failed_tests += test_name + "\n"; }
+		total++;
+
+		std::stop_source source;
+		search_handle cancelled{async.search_async(search_limits{}, source.get_token())};
+		source.request_stop();
+		test_name = "Async search stops on the caller's stop token";
+		if (test_check_moves(is_legal(middlegame, ai_side, cancelled.get().best_move), true, test_name)) {
+			passed++;
+		} else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		const search_result finished{async.search_async(search_limits{.depth = 4}).get()};
+		test_name = "Async search to a depth reports the depth and a move";
+		if (test_check_moves(finished.depth == 4 && is_legal(middlegame, ai_side, finished.best_move), true,
+		                     test_name)) {
+			passed++;
+		} else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		// the ai moves, then thinks about its answer to the reply it expects while the opponent is to move
+		async.ai_move(5);
+		const std::string after_ai{async.get_board()};
+		const chess_move reply{async.expected_reply()};
+		search_handle pondering{async.ponder(reply)};
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		pondering.stop();
+		const chess_move answer{pondering.get().best_move};
+		async.move(reply.from(), reply.to());
+		test_name = "Ponder searches the answer to the expected reply";
+		if (test_check_moves(is_legal(after_ai, opponent, reply) && is_legal(async.get_board(), ai_side, answer), true,
+		                     test_name)) {
+			passed++;
+		} else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		// a4 to a5 has nothing to move, as a reply from a stale table might not
+		chess stale(middlegame);
+		const piece_color stale_opponent{
+			stale.get_ai_color() == piece_color::WHITE ? piece_color::BLACK : piece_color::WHITE
+		};
+		search_handle stale_pondering{stale.ponder(chess_move{31, 39, move_flag::QUIET})};
+		std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		stale_pondering.stop();
+		const chess_move stale_answer{stale_pondering.get().best_move};
+		test_name = "Ponder searches the opponent's moves when the reply isn't legal";
+		if (test_check_moves(is_legal(middlegame, stale_opponent, stale_answer), true, test_name)) { passed++; } else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+	}
+
+	// ==========================================
+	// --- PRINCIPAL VARIATION TESTS ---
+	// ==========================================
+
+	{
+		// the line can be played from fen with side to move
+		auto plays_legally = [](const std::string &fen, const piece_color side, const std::vector<chess_move> &line) {
+			chess copy{fen + (side == piece_color::WHITE ? " w" : " b")};
+			for (const chess_move move: line) {
+				const move_list moves{copy.get_legal_moves()};
+				if (std::ranges::find(moves, move) == moves.end()) { return false; }
+				copy.move(move.from(), move.to());
+			}
+			return true;
+		};
+
+		const std::string middlegame{"r1bq1rk1/pp2bppp/2n1pn2/3p4/2PP4/2N1PN2/PP2BPPP/R2QKB1R"};
+		chess multi(middlegame);
+		multi.set_multi_pv(3);
+		const search_result three{multi.search_async(search_limits{.depth = 5}).get()};
+
+		bool distinct{three.lines.size() == 3};
+		bool ordered{distinct};
+		bool legal{distinct};
+		for (size_t i{0}; distinct && i < three.lines.size(); i++) {
+			for (size_t j{0}; j < i; j++) {
+				if (three.lines[i].moves[0] == three.lines[j].moves[0]) { distinct = false; }
+			}
+			if (i > 0 && three.lines[i].score > three.lines[i - 1].score) { ordered = false; }
+			if (!plays_legally(middlegame, multi.get_ai_color(), three.lines[i].moves)) { legal = false; }
+		}
+		test_name = "Multi-PV finds three different root moves, best first";
+		if (test_check_moves(distinct && ordered && three.lines[0].moves[0] == three.best_move
+		                     && three.lines[0].score == three.score, true, test_name)) { passed++; } else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		test_name = "Multi-PV lines can be played out";
+		if (test_check_moves(legal && three.lines[0].moves.size() > 1, true, test_name)) { passed++; } else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		// a line is never longer than its depth, one that is comes from the iteration the node limit cut off
+		bool kept_deeper{false};
+		bool consistent{true};
+		for (uint64_t nodes{5000}; nodes <= 50000; nodes += 5000) {
+			chess cut(middlegame + " w");
+			cut.set_multi_pv(3);
+			const search_result cut_result{cut.analyze(search_limits{.nodes = nodes})};
+			if (cut_result.lines.size() != 3 || cut_result.lines[0].moves[0] != cut_result.best_move
+			    || cut_result.lines[0].score != cut_result.score) { consistent = false; }
+			for (size_t i{0}; i < cut_result.lines.size(); i++) {
+				for (size_t j{0}; j < i; j++) {
+					if (cut_result.lines[i].moves[0] == cut_result.lines[j].moves[0]) { consistent = false; }
+				}
+			}
+			if (!cut_result.lines.empty() && cut_result.lines[0].moves.size() > static_cast<size_t>(cut_result.depth)) {
+				kept_deeper = true;
+			}
+		}
+		test_name = "Multi-PV cut off after its first line keeps that line";
+		if (test_check_moves(kept_deeper && consistent, true, test_name)) { passed++; } else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		// the black king only has a7 and b8, white has plenty
+		chess cornered("k7/8/2Q5/8/8/8/8/7K");
+		cornered.set_multi_pv(3);
+		const search_result forced{cornered.search_async(search_limits{.depth = 3}).get()};
+		const size_t expected_lines{forced.best_move.from() == 63 ? 2u : 3u}; // black moved the king from a8
+		multi.set_multi_pv(1);
+		const search_result single{multi.search_async(search_limits{.depth = 4}).get()};
+		test_name = "Multi-PV stops at the number of legal moves, single PV gives one line";
+		if (test_check_moves(forced.lines.size() == expected_lines && single.lines.size() == 1
+		                     && single.lines[0].moves[0] == single.best_move, true, test_name)) { passed++; } else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		// analyze knows whose move it is, white mates on the back rank
+		chess analysis("r5k1/5ppp/8/8/8/8/5PPP/R5K1 w");
+		const search_result mate{analysis.analyze(4)};
+		test_name = "Analyze finds the mate without playing it";
+		const bool mates{mate.best_move == chess_move{7, 63, move_flag::CAPTURE} && mate.score > 100000};
+		if (test_check_moves(mates && analysis.get_board() == "r5k1/5ppp/8/8/8/8/5PPP/R5K1", true, test_name)) {
+			passed++;
+		} else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		// the rook ladder mates in two (Ra7 then Rb8), three plies from the root however deep the search goes
+		chess ladder("7k/8/8/8/8/8/8/RR4K1 w");
+		const search_result ladder_mate{ladder.analyze(6)};
+		test_name = "Mate scores count the plies from the root to the mate";
+		if (test_check_moves(mate.score == 1000000 - 1 && ladder_mate.score == 1000000 - 3, true, test_name)) {
+			passed++;
+		} else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+
+		chess deep(middlegame + " w");
+		const search_result line{deep.analyze(6)};
+		deep.set_threads(3);
+		deep.set_parallel_mode(parallel_mode::YBWC);
+		const search_result split_line{deep.analyze(6)};
+		test_name = "Analyze returns a full principal variation, with split nodes too";
+		const std::vector<chess_move> &pv{line.lines[0].moves};
+		const std::vector<chess_move> &split_pv{split_line.lines[0].moves};
+		if (test_check_moves(line.lines.size() == 1 && pv.size() == 6 && pv[0] == line.best_move
+		                     && plays_legally(middlegame, piece_color::WHITE, pv) && split_pv.size() > 1
+		                     && plays_legally(middlegame, piece_color::WHITE, split_pv)
+		                     && deep.get_board() == middlegame, true, test_name)) { passed++; } else {
+			failed_tests += test_name + "\n";
+		}
+		total++;
+	}
+
+	// both queens can take a pawn that only their king can recapture, depth 1 alone would grab it
+	game.set_board("1q4k1/1p5p/8/8/8/8/1P5P/1Q4K1");
+	game.ai_move(1);
+	test_name = "Quiescence sees the recapture at depth 1";
+	if (test_check_moves(game.get_board() != "1q4k1/1p5Q/8/8/8/8/1P5P/6K1" &&
+	                     game.get_board() != "6k1/1p5p/8/8/8/8/1P5q/1Q4K1", true, test_name)) { passed++; } else {
+		failed_tests += test_name + "\n";
+	}
+	total++;
+
+	// either side mates on the back rank, a mate score is searched with the full window rather than an aspiration one
+	game.set_board("r5k1/5ppp/8/8/8/8/5PPP/R5K1");
+	game.ai_move(5);
+	test_name = "AI plays the mate with aspiration windows on";
+	if (test_check_moves(game.get_board() == "R5k1/5ppp/8/8/8/8/5PPP/6K1" ||
+	                     game.get_board() == "6k1/5ppp/8/8/8/8/5PPP/r5K1", true, test_name)) { passed++; } else {
+		failed_tests += test_name + "\n";
+	}
+	total++;
+
+	game.set_board("r5k1/5ppp/8/8/8/8/5PPP/R5K1");
+	game.set_threads(2);
+	game.set_parallel_mode(parallel_mode::YBWC);
+	game.ai_move(5);
+	game.set_threads(1);
+	test_name = "AI with split nodes plays the mate";
+	if (test_check_moves(game.get_board() == "R5k1/5ppp/8/8/8/8/5PPP/6K1" ||
+	                     game.get_board() == "6k1/5ppp/8/8/8/8/5PPP/r5K1", true, test_name)) { passed++; } else {
+		failed_tests += test_name + "\n";
+	}
+	total++;
+
 	std::cout << std::endl << "AI TESTING" << std::endl;
 
 	std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();